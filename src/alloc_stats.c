@@ -0,0 +1,137 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "alloc_stats.h"
+
+#ifdef TRY_ALLOC_STATS
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every block carries its requested size and phase in front, so frees and
+// reallocs are charged to the phase that made the block
+typedef union {
+  struct {
+    size_t size;
+    AllocPhase phase;
+  } h;
+  max_align_t align;
+} BlockHeader;
+
+typedef struct {
+  atomic_ullong allocs;       // malloc/calloc, and realloc of NULL
+  atomic_ullong bytes;        // Requested by those, plus realloc growth
+  atomic_ullong reallocs;     // Resizes of an existing block
+  atomic_ullong moves;        // Resizes that moved (copied) the block
+  atomic_ullong moved_bytes;  // Bytes copied by those
+  atomic_ullong frees;
+  atomic_llong live;          // Bytes currently allocated by this phase
+  atomic_llong peak;
+} PhaseCounters;
+
+static PhaseCounters counters[ALLOC_PHASE_COUNT];
+static _Thread_local AllocPhase current_phase = ALLOC_COMMANDS;
+
+static const char *phase_names[ALLOC_PHASE_COUNT] = {
+    "commands", "scan", "fuzzy", "render", "input",
+};
+
+static void add_live(AllocPhase phase, long long delta) {
+  PhaseCounters *c = &counters[phase];
+  long long live = atomic_fetch_add(&c->live, delta) + delta;
+  long long peak = atomic_load(&c->peak);
+  while (live > peak && !atomic_compare_exchange_weak(&c->peak, &peak, live))
+    ;
+}
+
+static void *track(BlockHeader *b, size_t size) {
+  if (!b)
+    return NULL;
+  b->h.size = size;
+  b->h.phase = current_phase;
+  atomic_fetch_add(&counters[current_phase].allocs, 1);
+  atomic_fetch_add(&counters[current_phase].bytes, size);
+  add_live(current_phase, (long long)size);
+  return b + 1;
+}
+
+void *alloc_stats_malloc(size_t size) {
+  return track(malloc(sizeof(BlockHeader) + size), size);
+}
+
+void *alloc_stats_calloc(size_t n, size_t size) {
+  if (size != 0 && n > (SIZE_MAX - sizeof(BlockHeader)) / size)
+    return NULL;
+  return track(calloc(1, sizeof(BlockHeader) + n * size), n * size);
+}
+
+void *alloc_stats_realloc(void *p, size_t size) {
+  if (!p)
+    return alloc_stats_malloc(size);
+  BlockHeader *old = (BlockHeader *)p - 1;
+  size_t old_size = old->h.size;
+  AllocPhase old_phase = old->h.phase;
+  uintptr_t old_addr = (uintptr_t)old;
+
+  BlockHeader *b = realloc(old, sizeof(BlockHeader) + size);
+  if (!b)
+    return NULL;
+  PhaseCounters *c = &counters[current_phase];
+  atomic_fetch_add(&c->reallocs, 1);
+  if (size > old_size)
+    atomic_fetch_add(&c->bytes, size - old_size);
+  if ((uintptr_t)b != old_addr) {
+    atomic_fetch_add(&c->moves, 1);
+    atomic_fetch_add(&c->moved_bytes, old_size < size ? old_size : size);
+  }
+  // The block now belongs to whoever resized it
+  add_live(old_phase, -(long long)old_size);
+  add_live(current_phase, (long long)size);
+  b->h.size = size;
+  b->h.phase = current_phase;
+  return b + 1;
+}
+
+void alloc_stats_free(void *p) {
+  if (!p)
+    return;
+  BlockHeader *b = (BlockHeader *)p - 1;
+  atomic_fetch_add(&counters[b->h.phase].frees, 1);
+  add_live(b->h.phase, -(long long)b->h.size);
+  free(b);
+}
+
+AllocPhase alloc_phase_enter(AllocPhase phase) {
+  AllocPhase prev = current_phase;
+  current_phase = phase;
+  return prev;
+}
+
+void alloc_phase_restore(AllocPhase *prev) {
+  current_phase = *prev;
+}
+
+void alloc_stats_report(void) {
+  fprintf(stderr, "try alloc stats:\n");
+  fprintf(stderr, "  %-9s %10s %12s %12s %9s %8s %12s %10s\n", "phase", "allocs",
+          "bytes", "peak live", "reallocs", "moves", "moved bytes", "at exit");
+  for (int i = 0; i < ALLOC_PHASE_COUNT; i++) {
+    PhaseCounters *c = &counters[i];
+    fprintf(stderr, "  %-9s %10llu %12llu %12lld %9llu %8llu %12llu %10lld\n",
+            phase_names[i], (unsigned long long)atomic_load(&c->allocs),
+            (unsigned long long)atomic_load(&c->bytes), (long long)atomic_load(&c->peak),
+            (unsigned long long)atomic_load(&c->reallocs),
+            (unsigned long long)atomic_load(&c->moves),
+            (unsigned long long)atomic_load(&c->moved_bytes),
+            (long long)atomic_load(&c->live));
+  }
+}
+
+#endif // TRY_ALLOC_STATS
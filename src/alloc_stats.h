@@ -0,0 +1,55 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+// Allocation accounting for `make ALLOC_STATS=1`. That build force-includes
+// this header ahead of everything else, so Z_MALLOC and friends (and with
+// them every zstr, zvec and zlist allocation) go through counting wrappers.
+// Counts are kept per phase, the subsystem the allocating thread was in,
+// and printed to stderr at exit. In a normal build ALLOC_PHASE() is a
+// no-op and nothing here is compiled in.
+//
+// Only compiler-provided headers may be included here: it's read before the
+// feature test macros at the top of each .c file.
+
+#include <stddef.h>
+
+typedef enum {
+  ALLOC_COMMANDS, // Default: argument handling, commands, prune
+  ALLOC_SCAN,     // scan_tries()
+  ALLOC_FUZZY,    // Filtering and ranking
+  ALLOC_RENDER,   // Drawing the selector and its dialogs
+  ALLOC_INPUT,    // Editing the query
+  ALLOC_PHASE_COUNT
+} AllocPhase;
+
+#ifdef TRY_ALLOC_STATS
+
+void *alloc_stats_malloc(size_t size);
+void *alloc_stats_calloc(size_t n, size_t size);
+void *alloc_stats_realloc(void *p, size_t size);
+void alloc_stats_free(void *p);
+
+#define Z_MALLOC(sz) alloc_stats_malloc(sz)
+#define Z_CALLOC(n, sz) alloc_stats_calloc(n, sz)
+#define Z_REALLOC(p, sz) alloc_stats_realloc(p, sz)
+#define Z_FREE(p) alloc_stats_free(p)
+
+// Switch the calling thread's phase, returning the previous one
+AllocPhase alloc_phase_enter(AllocPhase phase);
+void alloc_phase_restore(AllocPhase *prev);
+
+// Print the per-phase table (registered with atexit() by main)
+void alloc_stats_report(void);
+
+// Attribute allocations to `phase` until the enclosing scope ends
+#define ALLOC_PHASE(phase)                                                   \
+  AllocPhase alloc_phase_prev_ __attribute__((cleanup(alloc_phase_restore))) = \
+      alloc_phase_enter(phase)
+
+#else
+
+#define ALLOC_PHASE(phase) ((void)0)
+
+#endif // TRY_ALLOC_STATS
+
+#endif // ALLOC_STATS_H
@@ -1,18 +1,30 @@
 // Feature test macros for cross-platform compatibility
 #if defined(__APPLE__)
 #define _DARWIN_C_SOURCE
-#include <mach-o/dyld.h>
 #else
 #define _GNU_SOURCE
 #endif
 
 #include "commands.h"
 #include "config.h"
+#include "filter.h"
+#include "index.h"
+#include "learn.h"
+#include "maintain.h"
+#include "metrics.h"
+#include "prewarm.h"
+#include "libs/zvec_sort.h"
+#include "prune.h"
+#include "scan.h"
+#include "scratch.h"
+#include "stats.h"
 #include "tui.h"
 #include "utils.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -236,6 +248,18 @@ static zstr build_rename_script(const char *base_path, const char *old_name, con
   return script;
 }
 
+static zstr build_scratch_script(const char *scratch_path, const char *link_path) {
+  zstr script = zstr_init();
+  Z_CLEANUP(zstr_free) zstr escaped_scratch = shell_escape(scratch_path);
+  Z_CLEANUP(zstr_free) zstr escaped_link = shell_escape(link_path);
+  zstr_fmt(&script, "mkdir -p %s && \\\n", zstr_cstr(&escaped_scratch));
+  zstr_fmt(&script, "  ln -sfn %s %s && \\\n", zstr_cstr(&escaped_scratch),
+           zstr_cstr(&escaped_link));
+  zstr_fmt(&script, "  cd %s && \\\n", zstr_cstr(&escaped_link));
+  zstr_fmt(&script, "  printf '%%s\\n' %s\n", zstr_cstr(&escaped_link));
+  return script;
+}
+
 // Helper to generate date-prefixed directory name for clone
 // URL format: https://github.com/user/repo.git -> 2025-11-30-user-repo
 //             git@github.com:user/repo.git    -> 2025-11-30-user-repo
@@ -352,23 +376,7 @@ void cmd_init(int argc, char **argv, const char *tries_path) {
   // Get the path to this executable using realpath for absolute path
   char exe_path[1024];
   char *resolved_path = NULL;
-  bool got_path = false;
-
-  // Try /proc/self/exe first (Linux)
-  ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
-  if (len != -1) {
-    exe_path[len] = '\0';
-    got_path = true;
-  }
-#ifdef __APPLE__
-  else {
-    // Try _NSGetExecutablePath on macOS
-    uint32_t size = sizeof(exe_path);
-    if (_NSGetExecutablePath(exe_path, &size) == 0) {
-      got_path = true;
-    }
-  }
-#endif
+  bool got_path = self_exe_path(exe_path, sizeof(exe_path));
 
   // Resolve to absolute path, handling symlinks
   const char *self_path;
@@ -471,22 +479,112 @@ zstr cmd_worktree(int argc, char **argv, const char *tries_path) {
 // Selector command - returns script
 // ============================================================================
 
+// ============================================================================
+// Jump - cd to the best match without the selector
+// ============================================================================
+
+// Scan and rank just far enough to know the winner and the runner-up.
+// Returns the number of matches found (at most 2 are ranked into top).
+static size_t rank_top_two(const char *tries_path, const char *query,
+                           vec_TryEntry *entries, NameArena *names,
+                           vec_TryEntryPtr *top) {
+  scan_tries(tries_path, entries, names);
+  learn_open(tries_path);
+  FilterResult res = filter_rank(entries, query, 2, 0, top);
+  learn_close();
+  return res.matched;
+}
+
+zstr cmd_first(int argc, char **argv, const char *tries_path) {
+  // No query ranks on recency alone, which makes `try -` the last used try
+  const char *query = (argc > 0) ? argv[0] : "";
+
+  vec_TryEntry entries = {0};
+  NameArena names = {0};
+  vec_TryEntryPtr top = {0};
+  zstr script = zstr_init();
+  if (rank_top_two(tries_path, query, &entries, &names, &top) > 0) {
+    Z_CLEANUP(zstr_free) zstr path = try_entry_path(tries_path, top.data[0]);
+    script = build_cd_script(zstr_cstr(&path));
+    prewarm_spawn(zstr_cstr(&path));
+  } else if (*query) {
+    fprintf(stderr, "No try matches '%s'.\n", query);
+  } else {
+    fprintf(stderr, "No tries yet.\n");
+  }
+  vec_free_TryEntryPtr(&top);
+  free_try_entries(&entries, &names);
+  return script;
+}
+
+// The winner's path if it beats the runner-up by at least margin (or is the
+// only match), empty otherwise
+static zstr find_unambiguous(const char *tries_path, const char *query, double margin) {
+  vec_TryEntry entries = {0};
+  NameArena names = {0};
+  vec_TryEntryPtr top = {0};
+  zstr path = zstr_init();
+  size_t matched = rank_top_two(tries_path, query, &entries, &names, &top);
+  if (matched == 1 ||
+      (matched > 1 && top.data[0]->score - top.data[1]->score >= margin)) {
+    path = try_entry_path(tries_path, top.data[0]);
+  }
+  vec_free_TryEntryPtr(&top);
+  free_try_entries(&entries, &names);
+  return path;
+}
+
 zstr cmd_selector(int argc, char **argv, const char *tries_path, TestParams *test) {
-  const char *initial_filter = (argc > 0) ? argv[0] : NULL;
+  const char *initial_filter = NULL;
+  double auto_accept = -1.0; // Off
+
+  for (int i = 0; i < argc; i++) {
+    const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+    const char *value;
+    int skip = 0;
+
+    if ((value = parse_option_value(argv[i], next, "--auto-accept", &skip))) {
+      char *end;
+      auto_accept = strtod(value, &end);
+      if (end == value || *end || auto_accept < 0) {
+        fprintf(stderr, "Invalid margin: %s (use a score difference, e.g. 1.5)\n", value);
+        return zstr_init();
+      }
+      i += skip;
+    } else if (!initial_filter) {
+      initial_filter = argv[i];
+    }
+  }
+
+  // Clear winner: skip the TUI entirely
+  if (auto_accept >= 0 && initial_filter && *initial_filter) {
+    Z_CLEANUP(zstr_free) zstr winner = find_unambiguous(tries_path, initial_filter, auto_accept);
+    if (!zstr_is_empty(&winner)) {
+      prewarm_spawn(zstr_cstr(&winner));
+      return build_cd_script(zstr_cstr(&winner));
+    }
+  }
 
   SelectionResult result = run_selector(tries_path, initial_filter, test);
+  stats_report(stderr);
 
   zstr script = zstr_init();
 
   if (result.type == ACTION_CD) {
     script = build_cd_script(zstr_cstr(&result.path));
+    prewarm_spawn(zstr_cstr(&result.path));
   } else if (result.type == ACTION_MKDIR) {
     script = build_mkdir_script(zstr_cstr(&result.path));
+    const char *name = strrchr(zstr_cstr(&result.path), '/');
+    if (name)
+      index_journal(tries_path, JOURNAL_ADD, name + 1, NULL);
   } else if (result.type == ACTION_DELETE) {
     script = build_delete_script(tries_path, &result.delete_names);
-    // Free the delete_names vector
+    // Journal the deletions, then free the delete_names vector
     zstr *iter;
     vec_foreach(&result.delete_names, iter) {
+      if (!zstr_is_empty(&script))
+        index_journal(tries_path, JOURNAL_DELETE, zstr_cstr(iter), NULL);
       zstr_free(iter);
     }
     vec_free_zstr(&result.delete_names);
@@ -494,6 +592,11 @@ zstr cmd_selector(int argc, char **argv, const char *tries_path, TestParams *tes
     script = build_rename_script(tries_path,
                                   zstr_cstr(&result.rename_old_name),
                                   zstr_cstr(&result.rename_new_name));
+    // Cached metadata moves to the new name at the next load; if the mv
+    // doesn't happen, the scan moves it back by inode
+    if (!zstr_is_empty(&script))
+      index_journal(tries_path, JOURNAL_RENAME, zstr_cstr(&result.rename_old_name),
+                    zstr_cstr(&result.rename_new_name));
     zstr_free(&result.rename_old_name);
     zstr_free(&result.rename_new_name);
   } else {
@@ -505,6 +608,472 @@ zstr cmd_selector(int argc, char **argv, const char *tries_path, TestParams *tes
   return script;
 }
 
+// ============================================================================
+// List command - ranked paths for scripts and editor integrations
+// ============================================================================
+
+// Print an entry's path straight from its name, without building it
+static void put_entry_path(const char *tries_path, const TryEntry *entry) {
+  if (entry->persisted) {
+    Z_CLEANUP(zstr_free) zstr path = try_entry_path(tries_path, entry);
+    fputs(zstr_cstr(&path), stdout);
+  } else {
+    printf("%s/%s", tries_path, entry->name.data);
+  }
+}
+
+// One query per line; blank lines are skipped, "-" reads stdin
+static bool read_queries(const char *file, vec_zstr *queries) {
+  FILE *fp = strcmp(file, "-") == 0 ? stdin : fopen(file, "r");
+  if (!fp) {
+    fprintf(stderr, "Cannot read queries file: %s\n", file);
+    return false;
+  }
+  char *line = NULL;
+  size_t cap = 0;
+  while (getline(&line, &cap, fp) != -1) {
+    char *query = trim(line);
+    if (*query)
+      vec_push_zstr(queries, zstr_from(query));
+  }
+  free(line);
+  if (fp != stdin)
+    fclose(fp);
+  return true;
+}
+
+int cmd_list(int argc, char **argv, const char *tries_path) {
+  const char *queries_file = NULL;
+  const char *query = NULL;
+  long limit = LIST_DEFAULT_LIMIT;
+
+  for (int i = 0; i < argc; i++) {
+    const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+    const char *value;
+    int skip = 0;
+
+    if ((value = parse_option_value(argv[i], next, "--queries-file", &skip))) {
+      queries_file = value;
+      i += skip;
+    } else if ((value = parse_option_value(argv[i], next, "--limit", &skip))) {
+      char *end;
+      limit = strtol(value, &end, 10);
+      if (end == value || *end || limit < 0) {
+        fprintf(stderr, "Invalid limit: %s\n", value);
+        return 1;
+      }
+      i += skip;
+    } else if (!query && strncmp(argv[i], "--", 2) != 0) {
+      query = argv[i];
+    } else {
+      fprintf(stderr, "Usage: try list [query] [--queries-file FILE] [--limit N]\n");
+      return 1;
+    }
+  }
+
+  vec_TryEntry entries = {0};
+  NameArena names = {0};
+  scan_tries(tries_path, &entries, &names);
+  learn_open(tries_path);
+
+  if (!queries_file) {
+    // Single query: path per line, best first
+    vec_TryEntryPtr ranked = {0};
+    FilterResult res = filter_rank(&entries, query ? query : "", (size_t)limit, 0, &ranked);
+    for (size_t i = 0; i < res.ranked; i++) {
+      put_entry_path(tries_path, ranked.data[i]);
+      putchar('\n');
+    }
+    vec_free_TryEntryPtr(&ranked);
+    learn_close();
+    free_try_entries(&entries, &names);
+    return 0;
+  }
+
+  // Batch: every query ranked in one pass, lines tagged "query<TAB>path"
+  vec_zstr queries = {0};
+  if (!read_queries(queries_file, &queries)) {
+    learn_close();
+    free_try_entries(&entries, &names);
+    return 1;
+  }
+  const char **query_ptrs = Z_CALLOC(queries.length ? queries.length : 1, sizeof(char *));
+  vec_RankedEntry *results = Z_CALLOC(queries.length ? queries.length : 1, sizeof(vec_RankedEntry));
+  for (size_t q = 0; q < queries.length; q++) {
+    query_ptrs[q] = zstr_cstr(&queries.data[q]);
+  }
+
+  filter_rank_batch(&entries, query_ptrs, queries.length, (size_t)limit, results);
+  for (size_t q = 0; q < queries.length; q++) {
+    RankedEntry *hit;
+    vec_foreach(&results[q], hit) {
+      printf("%s\t", query_ptrs[q]);
+      put_entry_path(tries_path, hit->entry);
+      putchar('\n');
+    }
+    vec_free_RankedEntry(&results[q]);
+  }
+
+  Z_FREE(results);
+  Z_FREE(query_ptrs);
+  zstr *iter;
+  vec_foreach(&queries, iter) {
+    zstr_free(iter);
+  }
+  vec_free_zstr(&queries);
+  learn_close();
+  free_try_entries(&entries, &names);
+  return 0;
+}
+
+int cmd_perf_report(int argc, char **argv) {
+  const char *log_path = getenv("TRY_METRICS_LOG");
+
+  for (int i = 0; i < argc; i++) {
+    const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+    const char *value;
+    int skip = 0;
+
+    if ((value = parse_option_value(argv[i], next, "--log", &skip))) {
+      log_path = value;
+      i += skip;
+    } else {
+      fprintf(stderr, "Usage: try perf-report [--log FILE]\n");
+      return 1;
+    }
+  }
+
+  if (!log_path || !*log_path) {
+    fprintf(stderr, "No metrics log. Set TRY_METRICS_LOG=FILE to record one, or pass --log FILE.\n");
+    return 1;
+  }
+  return metrics_report(log_path, stdout);
+}
+
+// ============================================================================
+// Scratch tries - tmpfs-backed, symlinked into the tries root
+// ============================================================================
+
+zstr cmd_tmp(int argc, char **argv, const char *tries_path) {
+  if (argc < 1) {
+    fprintf(stderr, "Usage: try --tmp <name>\n");
+    return zstr_init();
+  }
+
+  Z_CLEANUP(zstr_free) zstr normalized = normalize_dir_name(argv[0]);
+  if (zstr_is_empty(&normalized)) {
+    fprintf(stderr, "Invalid name: %s\n", argv[0]);
+    return zstr_init();
+  }
+
+  time_t now = time(NULL);
+  struct tm *t = localtime(&now);
+  char date_prefix[20];
+  strftime(date_prefix, sizeof(date_prefix), "%Y-%m-%d", t);
+
+  Z_CLEANUP(zstr_free) zstr dir_name = zstr_from(date_prefix);
+  zstr_cat(&dir_name, "-");
+  zstr_cat(&dir_name, zstr_cstr(&normalized));
+
+  // The per-user root lives in a world-writable directory, so create it
+  // ourselves and refuse anything we don't own
+  Z_CLEANUP(zstr_free) zstr root = scratch_root();
+  mkdir(zstr_cstr(&root), S_IRWXU);
+  struct stat sb;
+  if (lstat(zstr_cstr(&root), &sb) != 0 || !S_ISDIR(sb.st_mode) ||
+      sb.st_uid != getuid()) {
+    fprintf(stderr, "Error: scratch directory unusable: %s\n", zstr_cstr(&root));
+    return zstr_init();
+  }
+
+  Z_CLEANUP(zstr_free) zstr link_path = join_path(tries_path, zstr_cstr(&dir_name));
+  if (lstat(zstr_cstr(&link_path), &sb) == 0 && !scratch_is_link(zstr_cstr(&link_path))) {
+    fprintf(stderr, "Error: %s already exists\n", zstr_cstr(&link_path));
+    return zstr_init();
+  }
+
+  Z_CLEANUP(zstr_free) zstr scratch_path = join_path(zstr_cstr(&root), zstr_cstr(&dir_name));
+  return build_scratch_script(zstr_cstr(&scratch_path), zstr_cstr(&link_path));
+}
+
+zstr cmd_persist(int argc, char **argv, const char *tries_path) {
+  vec_zstr names = {0};
+  if (argc > 0) {
+    for (int i = 0; i < argc; i++) {
+      vec_push_zstr(&names, zstr_from(argv[i]));
+    }
+  } else {
+    // No names - persist every live scratch try in the root
+    vec_TryEntry entries = {0};
+    NameArena entry_names = {0};
+    scan_tries(tries_path, &entries, &entry_names);
+    TryEntry *entry;
+    vec_foreach(&entries, entry) {
+      if (!entry->is_scratch || entry->persisted)
+        continue;
+      Z_CLEANUP(zstr_free) zstr path = join_path(tries_path, entry->name.data);
+      if (scratch_is_link(zstr_cstr(&path))) {
+        vec_push_zstr(&names, zstr_from_view(entry->name));
+      }
+    }
+    free_try_entries(&entries, &entry_names);
+  }
+
+  ScratchSyncStats stats = {0};
+  int failed = 0;
+  zstr *name;
+  vec_foreach(&names, name) {
+    if (scratch_persist(tries_path, zstr_cstr(name), &stats) != 0)
+      failed++;
+    zstr_free(name);
+  }
+  size_t count = names.length;
+  vec_free_zstr(&names);
+
+  if (count == 0) {
+    fprintf(stderr, "No scratch tries to persist.\n");
+    return zstr_init();
+  }
+
+  Z_CLEANUP(zstr_free) zstr size = format_size(stats.bytes_copied);
+  Z_CLEANUP(zstr_free) zstr message = zstr_init();
+  zstr_fmt(&message, "Persisted %zu scratch tr%s: %llu changed files (%s), %llu unchanged, %llu removed",
+           count, count == 1 ? "y" : "ies",
+           (unsigned long long)stats.files_copied, zstr_cstr(&size),
+           (unsigned long long)stats.files_unchanged,
+           (unsigned long long)stats.entries_removed);
+  if (failed > 0)
+    zstr_fmt(&message, ", %d failed", failed);
+
+  Z_CLEANUP(zstr_free) zstr escaped = shell_escape(zstr_cstr(&message));
+  zstr script = zstr_init();
+  zstr_fmt(&script, "printf '%%s\\n' %s >&2\n", zstr_cstr(&escaped));
+  return script;
+}
+
+// ============================================================================
+// Prune command - returns delete script for tries matching the rules
+// ============================================================================
+
+// "30", "30d" or "4w" -> days, -1 on error
+static int parse_days(const char *s) {
+  char *end;
+  long n = strtol(s, &end, 10);
+  if (end == s || n < 0)
+    return -1;
+  if (*end == '\0' || strcmp(end, "d") == 0)
+    return (int)n;
+  if (strcmp(end, "w") == 0)
+    return (int)(n * 7);
+  return -1;
+}
+
+// "500", "500K", "1.5G" -> bytes, 0 on error
+static uint64_t parse_size(const char *s) {
+  char *end;
+  double n = strtod(s, &end);
+  if (end == s || n <= 0)
+    return 0;
+  switch (toupper((unsigned char)*end)) {
+  case '\0':
+    return (uint64_t)n;
+  case 'K':
+    return (uint64_t)(n * 1024);
+  case 'M':
+    return (uint64_t)(n * 1024 * 1024);
+  case 'G':
+    return (uint64_t)(n * 1024 * 1024 * 1024);
+  }
+  return 0;
+}
+
+// Oldest first; stable so equal ages keep scan order
+Z_VEC_GENERATE_SORT(PruneEval, prune_by_age, a->age_days > b->age_days)
+
+zstr cmd_prune(int argc, char **argv, const char *tries_path, TestParams *test) {
+  PruneRules rules = {.older_than_days = -1, .larger_than = 0, .git_clean = false};
+  bool has_rule = false;
+
+  for (int i = 0; i < argc; i++) {
+    const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+    const char *value;
+    int skip = 0;
+
+    if ((value = parse_option_value(argv[i], next, "--older-than", &skip))) {
+      rules.older_than_days = parse_days(value);
+      if (rules.older_than_days < 0) {
+        fprintf(stderr, "Invalid age: %s (use e.g. 30, 30d or 4w)\n", value);
+        return zstr_init();
+      }
+      has_rule = true;
+      i += skip;
+    } else if ((value = parse_option_value(argv[i], next, "--larger-than", &skip))) {
+      rules.larger_than = parse_size(value);
+      if (rules.larger_than == 0) {
+        fprintf(stderr, "Invalid size: %s (use e.g. 500M or 1G)\n", value);
+        return zstr_init();
+      }
+      has_rule = true;
+      i += skip;
+    } else if (strcmp(argv[i], "--git-clean") == 0) {
+      rules.git_clean = true;
+      has_rule = true;
+    } else {
+      fprintf(stderr, "Unknown prune option: %s\n", argv[i]);
+      has_rule = false;
+      break;
+    }
+  }
+
+  if (!has_rule) {
+    fprintf(stderr, "Usage: try prune [--older-than DAYS] [--larger-than SIZE] [--git-clean]\n");
+    fprintf(stderr, "Tries containing a " PIN_FILE_NAME " file are never pruned.\n");
+    return zstr_init();
+  }
+
+  vec_PruneEval evals = {0};
+  prune_evaluate(tries_path, &rules, &evals);
+
+  // Oldest first, with per-entry size/age and a grand total
+  vec_zstr names = {0};
+  vec_zstr details = {0};
+  uint64_t total = 0;
+  stable_sort_prune_by_age(evals.data, evals.length);
+  PruneEval *ev;
+  vec_foreach(&evals, ev) {
+    if (!ev->candidate)
+      continue;
+    Z_CLEANUP(zstr_free) zstr size = format_size(ev->size_bytes);
+    zstr detail = zstr_init();
+    zstr_fmt(&detail, "%s, %dd old%s", zstr_cstr(&size), ev->age_days,
+             ev->git == GIT_DIRTY     ? ", uncommitted changes"
+             : ev->git == GIT_UNKNOWN ? ", git status unknown"
+                                      : "");
+    vec_push_zstr(&names, zstr_dup(&ev->name));
+    vec_push_zstr(&details, detail);
+    total += ev->size_bytes;
+  }
+  prune_free(&evals);
+
+  zstr script = zstr_init();
+  if (names.length == 0) {
+    fprintf(stderr, "Nothing to prune.\n");
+  } else {
+    Z_CLEANUP(zstr_free) zstr total_str = format_size(total);
+    Z_CLEANUP(zstr_free) zstr summary = zstr_init();
+    zstr_fmt(&summary, "Total: %s in %zu director%s", zstr_cstr(&total_str),
+             names.length, names.length == 1 ? "y" : "ies");
+
+    if (run_delete_confirmation(&names, &details, zstr_cstr(&summary), test)) {
+      script = build_delete_script(tries_path, &names);
+    } else {
+      fprintf(stderr, "Cancelled.\n");
+    }
+  }
+
+  zstr *iter;
+  vec_foreach(&names, iter) {
+    zstr_free(iter);
+  }
+  vec_free_zstr(&names);
+  vec_foreach(&details, iter) {
+    zstr_free(iter);
+  }
+  vec_free_zstr(&details);
+  return script;
+}
+
+// ============================================================================
+// Maintain command - refresh cached sizes/git status within a budget
+// ============================================================================
+
+int cmd_maintain(int argc, char **argv, const char *tries_path) {
+  MaintainBudget budget = {.cpu_ms = MAINTAIN_CPU_MS, .io_bytes = MAINTAIN_IO_BYTES};
+
+  for (int i = 0; i < argc; i++) {
+    const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+    const char *value;
+    int skip = 0;
+
+    if ((value = parse_option_value(argv[i], next, "--cpu-ms", &skip))) {
+      char *end;
+      budget.cpu_ms = strtod(value, &end);
+      if (end == value || *end != '\0' || budget.cpu_ms < 0) {
+        fprintf(stderr, "Invalid CPU budget: %s (milliseconds, 0 = unlimited)\n", value);
+        return 1;
+      }
+      i += skip;
+    } else if ((value = parse_option_value(argv[i], next, "--io", &skip))) {
+      budget.io_bytes = strcmp(value, "0") == 0 ? 0 : parse_size(value);
+      if (budget.io_bytes == 0 && strcmp(value, "0") != 0) {
+        fprintf(stderr, "Invalid I/O budget: %s (use e.g. 64M, 0 = unlimited)\n", value);
+        return 1;
+      }
+      i += skip;
+    } else {
+      fprintf(stderr, "Usage: try maintain [--cpu-ms MS] [--io SIZE]\n");
+      return 1;
+    }
+  }
+
+  // Lowered first so the scan's stat threads and git children inherit it
+  maintain_lower_priority(true);
+
+  vec_TryEntry entries = {0};
+  NameArena names = {0};
+  scan_tries(tries_path, &entries, &names);
+  MaintainReport report = maintain_run(tries_path, &entries, &budget, NULL);
+  free_try_entries(&entries, &names);
+
+  Z_CLEANUP(zstr_free) zstr io = format_size(report.io_bytes);
+  printf("Checked %zu tries: %zu sizes, %zu git states in %.0fms CPU, %s read/written%s\n",
+         report.checked, report.sizes, report.git, report.cpu_ms, zstr_cstr(&io),
+         report.finished ? "" : " (budget reached, will resume)");
+  return 0;
+}
+
+// ============================================================================
+// Prewarm command - read a try ahead into the page cache
+// ============================================================================
+
+int cmd_prewarm(int argc, char **argv) {
+  const char *path = NULL;
+  uint64_t budget = PREWARM_BYTES;
+
+  for (int i = 0; i < argc; i++) {
+    const char *next = (i + 1 < argc) ? argv[i + 1] : NULL;
+    const char *value;
+    int skip = 0;
+
+    if ((value = parse_option_value(argv[i], next, "--budget", &skip))) {
+      budget = parse_size(value);
+      if (budget == 0) {
+        fprintf(stderr, "Invalid budget: %s (use e.g. 64M)\n", value);
+        return 1;
+      }
+      i += skip;
+    } else if (!path && argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      path = NULL;
+      break;
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "Usage: try prewarm <path> [--budget SIZE]\n");
+    return 1;
+  }
+
+  // Usually the detached helper, which nobody waits for
+  try_metrics_enabled = false;
+  maintain_lower_priority(true);
+  PrewarmReport report = prewarm_path(path, budget);
+  Z_CLEANUP(zstr_free) zstr bytes = format_size(report.bytes);
+  printf("Read ahead %s in %zu files (%zu entries scanned)\n", zstr_cstr(&bytes),
+         report.files, report.scanned);
+  return 0;
+}
+
 // ============================================================================
 // Route subcommands (for exec mode or main routing)
 // ============================================================================
@@ -550,6 +1119,29 @@ zstr cmd_route(int argc, char **argv, const char *tries_path, TestParams *test)
     return cmd_clone(argc - 1, argv + 1, tries_path);
   } else if (strcmp(subcmd, "worktree") == 0) {
     return cmd_worktree(argc - 1, argv + 1, tries_path);
+  } else if (strcmp(subcmd, "--tmp") == 0) {
+    return cmd_tmp(argc - 1, argv + 1, tries_path);
+  } else if (strcmp(subcmd, "persist") == 0) {
+    return cmd_persist(argc - 1, argv + 1, tries_path);
+  } else if (strcmp(subcmd, "prune") == 0) {
+    return cmd_prune(argc - 1, argv + 1, tries_path, test);
+  } else if (strcmp(subcmd, "--first") == 0) {
+    return cmd_first(argc - 1, argv + 1, tries_path);
+  } else if (strcmp(subcmd, "-") == 0) {
+    return cmd_first(0, NULL, tries_path);
+  } else if (strcmp(subcmd, "list") == 0) {
+    // List always prints directly
+    cmd_list(argc - 1, argv + 1, tries_path);
+    return zstr_init();
+  } else if (strcmp(subcmd, "perf-report") == 0) {
+    cmd_perf_report(argc - 1, argv + 1);
+    return zstr_init();
+  } else if (strcmp(subcmd, "maintain") == 0) {
+    cmd_maintain(argc - 1, argv + 1, tries_path);
+    return zstr_init();
+  } else if (strcmp(subcmd, "prewarm") == 0) {
+    cmd_prewarm(argc - 1, argv + 1);
+    return zstr_init();
   } else if (strncmp(subcmd, "https://", 8) == 0 ||
              strncmp(subcmd, "http://", 7) == 0 ||
              strncmp(subcmd, "git@", 4) == 0) {
@@ -9,11 +9,27 @@
 // Init command - outputs shell function definition (always prints directly)
 void cmd_init(int argc, char **argv, const char *tries_path);
 
+// List command - prints ranked paths directly, returns exit status
+int cmd_list(int argc, char **argv, const char *tries_path);
+
+// Perf-report command - summarizes TRY_METRICS_LOG, returns exit status
+int cmd_perf_report(int argc, char **argv);
+
+// Maintain command - refreshes the index within a budget, returns exit status
+int cmd_maintain(int argc, char **argv, const char *tries_path);
+
+// Prewarm command - reads a try ahead into the page cache, returns exit status
+int cmd_prewarm(int argc, char **argv);
+
 // Commands return shell scripts to execute
 // Returns empty zstr on error (after printing error to stderr)
 zstr cmd_clone(int argc, char **argv, const char *tries_path);
 zstr cmd_worktree(int argc, char **argv, const char *tries_path);
 zstr cmd_selector(int argc, char **argv, const char *tries_path, TestParams *test);
+zstr cmd_first(int argc, char **argv, const char *tries_path);
+zstr cmd_tmp(int argc, char **argv, const char *tries_path);
+zstr cmd_persist(int argc, char **argv, const char *tries_path);
+zstr cmd_prune(int argc, char **argv, const char *tries_path, TestParams *test);
 
 // Route subcommands (for exec mode)
 zstr cmd_route(int argc, char **argv, const char *tries_path, TestParams *test);
@@ -8,4 +8,91 @@
 
 #define DEFAULT_TRIES_PATH_SUFFIX "src/tries" // Relative to HOME
 
+// Metadata cache kept inside the tries directory (see index.h)
+#define INDEX_FILE_NAME ".try-index"
+#define INDEX_TTL_SECONDS (24 * 60 * 60) // Recompute cached sizes/git status after a day
+#define INDEX_JOURNAL_SUFFIX ".journal"
+#define INDEX_JOURNAL_COMPACT 64 // Replayed records before the journal is folded in
+
+// Gitignore-style rules for the tries root (see ignore.h)
+#define IGNORE_FILE_NAME ".tryignore"
+
+// Scratch tries (try --tmp): tmpfs base (override with TRY_TMPFS) and the
+// directory inside the tries root that `try persist` mirrors them to
+#define DEFAULT_SCRATCH_TMPFS "/dev/shm"
+#define SCRATCH_PERSIST_DIR ".try-persist"
+
+// Marker file that protects a try from `try prune`
+#define PIN_FILE_NAME ".try-pin"
+
+// Default number of results per query for `try list` (--limit 0 = all)
+#define LIST_DEFAULT_LIMIT 20
+
+// Keystroke latencies kept per invocation in the TRY_METRICS_LOG line
+#define METRICS_MAX_SAMPLES 256
+
+// Time the selector spends on exact scores per keystroke. Past it the list
+// is ranked by upper bound and refined once no key is waiting. The bounding
+// pass before it is not covered: it must find every match for narrowing to
+// stay correct, so its cost is kept down by the engine choice instead.
+#define FILTER_BUDGET_MS 16
+
+// Filter engine thresholds, on the predicted single-thread cost of a pass
+// (entries x measured cost per entry). Above SERIAL_MAX the matches are
+// bounded before they're scored; above PARALLEL_MIN bounding is split over
+// up to FILTER_MAX_THREADS threads of at least FILTER_MIN_CHUNK entries.
+// Going back down takes half the threshold. Until a pass has been measured,
+// pools above FILTER_SERIAL_MAX_ENTRIES start prefiltered.
+#define FILTER_SERIAL_MAX_MS 0.5
+#define FILTER_PARALLEL_MIN_MS 6.0
+#define FILTER_SERIAL_MAX_ENTRIES 2000
+#define FILTER_MAX_THREADS 8
+#define FILTER_MIN_CHUNK 4096
+
+// Budgets for index maintenance (see maintain.h): `try maintain` and the
+// idle pass the selector starts once it has been waiting for DELAY. Only
+// tries whose cached sizes or git status are stale cost anything. A pass
+// saves its progress when it stops and every CHECKPOINT_MS in between; on
+// exit the selector waits up to STOP_WAIT_MS for the idle pass to save.
+#define MAINTAIN_CPU_MS 5000
+#define MAINTAIN_IO_BYTES (256ull * 1024 * 1024)
+#define MAINTAIN_IDLE_CPU_MS 300
+#define MAINTAIN_IDLE_IO_BYTES (16ull * 1024 * 1024)
+#define MAINTAIN_IDLE_DELAY_MS 1000
+#define MAINTAIN_CHECKPOINT_MS 5000
+#define MAINTAIN_STOP_WAIT_MS 50
+#define MAINTAIN_NICE 19
+
+// Page-cache prewarm after entering a try (see prewarm.h): bytes read
+// ahead by default, and directory entries walked to find the newest files
+#define PREWARM_BYTES (64ull * 1024 * 1024)
+#define PREWARM_MAX_SCAN 50000
+
+// Selection learning (see learn.h): the table in the tries root, its slots
+// (a power of two) and how far a prefix may land from its home slot, the
+// tries remembered per prefix, the query characters learned, and the bonus
+// a habitual pick approaches, halving every HALF_LIFE_DAYS without picks
+#define LEARN_FILE_NAME ".try-learn"
+#define LEARN_SLOTS 4096
+#define LEARN_PROBE 8
+#define LEARN_TARGETS 4
+#define LEARN_MAX_PREFIX 8
+#define LEARN_BONUS 5.0
+#define LEARN_HALF_LIFE_DAYS 30
+
+// Next-character branches precomputed by --speculate
+#define SPECULATE_BRANCHES 4
+
+// Directory scans stat() entries on worker threads so a try that lives on
+// a hung mount (stale NFS, sshfs) can't freeze the selector. A stat that
+// takes longer than the timeout is abandoned and the entry shown from the
+// index; it isn't retried until the stale TTL has passed. The whole batch
+// gets SCAN_DEADLINE_MS, however many calls hang; entries not stat()ed by
+// then are shown from the index too and tried again next scan.
+#define SCAN_STAT_THREADS 8
+#define SCAN_MAX_THREADS 32 // Including workers left behind in a hung stat()
+#define SCAN_STAT_TIMEOUT_MS 250
+#define SCAN_DEADLINE_MS (SCAN_STAT_TIMEOUT_MS + 100)
+#define STALE_MOUNT_TTL_SECONDS (10 * 60)
+
 #endif // CONFIG_H
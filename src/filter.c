@@ -0,0 +1,574 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "filter.h"
+#include "alloc_stats.h"
+#include "config.h"
+#include "fuzzy.h"
+#include "learn.h"
+#include "libs/zvec_sort.h"
+#include "stats.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+// Ordering
+// ============================================================================
+
+// Higher score first; ties go to the earlier entry (entries live in one
+// array, so pointer order is scan order)
+static bool ranks_before(const RankedEntry *a, const RankedEntry *b) {
+  if (a->score != b->score)
+    return a->score > b->score;
+  return a->entry < b->entry;
+}
+
+// sort_ranked() and friends, with ranks_before() inlined
+Z_VEC_GENERATE_SORT(RankedEntry, ranked, ranks_before(a, b))
+
+// ============================================================================
+// Top-K heap (root is the worst kept entry)
+// ============================================================================
+
+typedef struct {
+  RankedEntry *items;
+  size_t length;
+  size_t limit;
+} TopK;
+
+static void heap_sift_down(TopK *h, size_t i) {
+  for (;;) {
+    size_t worst = i;
+    size_t l = 2 * i + 1, r = l + 1;
+    if (l < h->length && ranks_before(&h->items[worst], &h->items[l]))
+      worst = l;
+    if (r < h->length && ranks_before(&h->items[worst], &h->items[r]))
+      worst = r;
+    if (worst == i)
+      return;
+    RankedEntry tmp = h->items[i];
+    h->items[i] = h->items[worst];
+    h->items[worst] = tmp;
+    i = worst;
+  }
+}
+
+static void heap_sift_up(TopK *h, size_t i) {
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (!ranks_before(&h->items[parent], &h->items[i]))
+      return;
+    RankedEntry tmp = h->items[i];
+    h->items[i] = h->items[parent];
+    h->items[parent] = tmp;
+    i = parent;
+  }
+}
+
+// Offer a matching entry. The bound is checked before the exact score is
+// computed; later entries lose ties, so a bound equal to the worst kept
+// score can't displace it either. bonus is the entry's learned bonus, which
+// the bound already includes. Returns false if the entry wasn't kept, and
+// reports any entry it displaced through *evicted.
+static bool topk_offer(TopK *h, TryEntry *entry, float bound, float bonus,
+                       const char *query, time_t now, bool *pruned, TryEntry **evicted) {
+  *pruned = false;
+  *evicted = NULL;
+  if (h->length == h->limit && bound <= h->items[0].score) {
+    *pruned = true;
+    return false;
+  }
+
+  RankedEntry r = {entry, fuzzy_score(entry, query, now) + bonus};
+  if (h->length < h->limit) {
+    h->items[h->length] = r;
+    heap_sift_up(h, h->length++);
+    return true;
+  }
+  if (!ranks_before(&r, &h->items[0]))
+    return false;
+  *evicted = h->items[0].entry;
+  h->items[0] = r;
+  heap_sift_down(h, 0);
+  return true;
+}
+
+static void topk_sort(TopK *h) {
+  sort_ranked(h->items, h->length);
+}
+
+// ============================================================================
+// Candidates (best-first heap on the bound)
+// ============================================================================
+
+// Matches from the cheap pass, with their upper bound in place of the score.
+// The root is the candidate that could rank best.
+typedef struct {
+  RankedEntry *items;
+  size_t length;
+} Candidates;
+
+static void candidates_sift_down(Candidates *c, size_t i) {
+  for (;;) {
+    size_t best = i;
+    size_t l = 2 * i + 1, r = l + 1;
+    if (l < c->length && ranks_before(&c->items[l], &c->items[best]))
+      best = l;
+    if (r < c->length && ranks_before(&c->items[r], &c->items[best]))
+      best = r;
+    if (best == i)
+      return;
+    RankedEntry tmp = c->items[i];
+    c->items[i] = c->items[best];
+    c->items[best] = tmp;
+    i = best;
+  }
+}
+
+static RankedEntry candidates_pop(Candidates *c) {
+  RankedEntry top = c->items[0];
+  c->items[0] = c->items[--c->length];
+  candidates_sift_down(c, 0);
+  return top;
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+// ============================================================================
+// Ranking
+// ============================================================================
+
+// Per-entry state so the matches that didn't rank can be listed afterwards
+enum { NO_MATCH, MATCHED, KEPT, CANDIDATE };
+
+// Exact scores refined between clock checks
+#define REFINE_CHECK_EVERY 32
+
+// What the engines share for one call
+typedef struct {
+  vec_TryEntry *entries;
+  bool restricted; // Only entries in state CANDIDATE are in the pool
+  unsigned char *state;
+  const char *query;
+  time_t now;
+  const atomic_bool *cancel;
+  LearnBoosts boosts; // Learned bonuses for query
+} RankJob;
+
+// Added to both bound and score, so the bound stays an upper bound
+static inline float job_bonus(const LearnBoosts *boosts, const TryEntry *entry) {
+  return boosts->count ? learn_bonus(boosts, entry) : 0;
+}
+
+// Serial engine: one pass in scan order, scoring each match as soon as its
+// bound says it could still rank. Nothing to set up, so it wins on small
+// pools.
+static size_t rank_serial(const RankJob *job, TopK *heap, size_t *scored) {
+  size_t matched = 0;
+  for (size_t i = 0; i < job->entries->length; i++) {
+    if (job->cancel && (i & 255) == 0 &&
+        atomic_load_explicit(job->cancel, memory_order_relaxed))
+      break;
+    if (job->restricted && job->state[i] != CANDIDATE)
+      continue;
+    job->state[i] = NO_MATCH;
+    TryEntry *entry = &job->entries->data[i];
+    float bound;
+    bool pruned;
+    TryEntry *evicted;
+    if (!fuzzy_bound(entry, job->query, job->now, &bound))
+      continue;
+    matched++;
+    job->state[i] = MATCHED;
+    float bonus = job_bonus(&job->boosts, entry);
+    if (topk_offer(heap, entry, bound + bonus, bonus, job->query, job->now, &pruned, &evicted))
+      job->state[i] = KEPT;
+    if (evicted)
+      job->state[evicted - job->entries->data] = MATCHED;
+    if (!pruned)
+      (*scored)++;
+  }
+  return matched;
+}
+
+// Cheap pass over entries [lo, hi): subsequence test and upper bound.
+// Matches go to out in scan order. Non-matching entries never reach the
+// scorer at all.
+typedef struct {
+  const RankJob *job;
+  size_t lo, hi;
+  RankedEntry *out;
+  size_t found;
+  double work_ms; // Time spent, for the engine's cost estimate
+} BoundChunk;
+
+static void bound_chunk(BoundChunk *c) {
+  const RankJob *job = c->job;
+  double start = now_ms();
+  c->found = 0;
+  for (size_t i = c->lo; i < c->hi; i++) {
+    if (job->cancel && (i & 255) == 0 &&
+        atomic_load_explicit(job->cancel, memory_order_relaxed))
+      break;
+    if (job->restricted && job->state[i] != CANDIDATE)
+      continue;
+    job->state[i] = NO_MATCH;
+    TryEntry *entry = &job->entries->data[i];
+    float bound;
+    if (!fuzzy_bound(entry, job->query, job->now, &bound))
+      continue;
+    job->state[i] = MATCHED;
+    c->out[c->found++] = (RankedEntry){entry, bound + job_bonus(&job->boosts, entry)};
+  }
+  c->work_ms = now_ms() - start;
+}
+
+static void *bound_worker(void *arg) {
+  bound_chunk(arg);
+  return NULL;
+}
+
+// The cheap pass split into `threads` contiguous chunks, the calling thread
+// taking the first. Each chunk writes its own slice of state and of out
+// (which must hold entries->length), then the slices are packed in order.
+// Returns the number of matches; *work_ms is the summed (single-thread
+// equivalent) time.
+static size_t bound_parallel(const RankJob *job, int threads, RankedEntry *out,
+                             double *work_ms) {
+  size_t n = job->entries->length;
+  BoundChunk chunks[FILTER_MAX_THREADS];
+  pthread_t tids[FILTER_MAX_THREADS];
+  bool started[FILTER_MAX_THREADS] = {false};
+  for (int t = 0; t < threads; t++) {
+    size_t lo = n * (size_t)t / (size_t)threads;
+    size_t hi = n * (size_t)(t + 1) / (size_t)threads;
+    chunks[t] = (BoundChunk){job, lo, hi, out + lo, 0, 0};
+  }
+  for (int t = 1; t < threads; t++)
+    started[t] = pthread_create(&tids[t], NULL, bound_worker, &chunks[t]) == 0;
+  bound_chunk(&chunks[0]);
+  for (int t = 1; t < threads; t++) {
+    if (started[t])
+      pthread_join(tids[t], NULL);
+    else
+      bound_chunk(&chunks[t]); // Couldn't start a thread: do it here
+  }
+
+  size_t found = 0;
+  *work_ms = 0;
+  for (int t = 0; t < threads; t++) {
+    memmove(out + found, chunks[t].out, chunks[t].found * sizeof(RankedEntry));
+    found += chunks[t].found;
+    *work_ms += chunks[t].work_ms;
+  }
+  return found;
+}
+
+// filter_rank_detached() over all entries, or only over candidates when
+// given. The serial engine does it in one pass. The others bound every
+// entry first (parallel: on several threads), then refine: score
+// candidates best bound first until no remaining bound can beat the worst
+// kept score. Visiting order doesn't matter for the result because
+// ranks_before() breaks ties by scan order. *work_ms (may be NULL) gets
+// the single-thread equivalent cost.
+static FilterResult rank_entries(vec_TryEntry *entries, const vec_TryEntryPtr *candidates,
+                                 const char *query, size_t limit, double budget_ms,
+                                 FilterEngine engine, int threads,
+                                 vec_RankedEntry *ranked, vec_TryEntryPtr *rest,
+                                 const atomic_bool *cancel, double *work_ms) {
+  ALLOC_PHASE(ALLOC_FUZZY);
+  FilterResult res = {.engine = engine};
+  vec_clear_RankedEntry(ranked);
+  vec_clear_TryEntryPtr(rest);
+  if (work_ms)
+    *work_ms = 0;
+  if (entries->length == 0)
+    return res;
+
+  size_t pool = candidates ? candidates->length : entries->length;
+  if (pool == 0)
+    return res;
+  if (limit == 0 || limit > pool)
+    limit = pool;
+
+  double start = now_ms();
+  double deadline = budget_ms > 0 ? start + budget_ms : 0;
+  size_t cand_cap = engine == FILTER_PARALLEL ? entries->length : pool;
+  TopK heap = {Z_MALLOC(limit * sizeof(RankedEntry)), 0, limit};
+  Candidates cands = {engine == FILTER_SERIAL ? NULL : Z_MALLOC(cand_cap * sizeof(RankedEntry)), 0};
+  unsigned char *state = Z_CALLOC(entries->length, 1);
+  if (!heap.items || (engine != FILTER_SERIAL && !cands.items) || !state) {
+    Z_FREE(heap.items);
+    Z_FREE(cands.items);
+    Z_FREE(state);
+    return res;
+  }
+  if (candidates) {
+    for (size_t i = 0; i < candidates->length; i++)
+      state[candidates->data[i] - entries->data] = CANDIDATE;
+  }
+  RankJob job = {entries, candidates != NULL, state, query, time(NULL), cancel, {0}};
+  learn_lookup(query, &job.boosts);
+  size_t scored = 0;
+
+  if (engine == FILTER_SERIAL) {
+    res.matched = rank_serial(&job, &heap, &scored);
+    if (work_ms)
+      *work_ms = now_ms() - start;
+  } else {
+    double bound_ms;
+    if (engine == FILTER_PARALLEL && threads > 1) {
+      res.matched = bound_parallel(&job, threads, cands.items, &bound_ms);
+    } else {
+      BoundChunk all = {&job, 0, entries->length, cands.items, 0, 0};
+      bound_chunk(&all);
+      res.matched = all.found;
+      bound_ms = all.work_ms;
+    }
+    cands.length = res.matched;
+    for (size_t i = cands.length / 2; i-- > 0;)
+      candidates_sift_down(&cands, i);
+
+    // Refine: exact scores, best bound first. Past the budget the remaining
+    // places are filled by bound alone and the result is marked truncated.
+    double refine_start = now_ms();
+    while (cands.length > 0) {
+      RankedEntry *worst = heap.length == heap.limit ? &heap.items[0] : NULL;
+      if (worst && !ranks_before(&cands.items[0], worst))
+        break; // No bound left can beat the worst kept score
+      if (!res.truncated && scored % REFINE_CHECK_EVERY == REFINE_CHECK_EVERY - 1) {
+        if (cancel && atomic_load_explicit(cancel, memory_order_relaxed))
+          break;
+        if (deadline && now_ms() > deadline)
+          res.truncated = true;
+      }
+
+      RankedEntry r = candidates_pop(&cands);
+      if (!res.truncated) {
+        r.score = fuzzy_score(r.entry, query, job.now) + job_bonus(&job.boosts, r.entry);
+        scored++;
+      }
+      if (heap.length < heap.limit) {
+        heap.items[heap.length] = r;
+        heap_sift_up(&heap, heap.length++);
+        state[r.entry - entries->data] = KEPT;
+      } else if (ranks_before(&r, worst)) {
+        state[worst->entry - entries->data] = MATCHED;
+        heap.items[0] = r;
+        heap_sift_down(&heap, 0);
+        state[r.entry - entries->data] = KEPT;
+      }
+    }
+    if (work_ms)
+      *work_ms = bound_ms + (now_ms() - refine_start);
+  }
+  res.pruned = res.matched - scored;
+
+  // Survivors best first, then the other matches in scan order
+  topk_sort(&heap);
+  for (size_t i = 0; i < heap.length; i++)
+    vec_push_RankedEntry(ranked, heap.items[i]);
+  res.ranked = heap.length;
+
+  if (res.matched > heap.length) {
+    for (size_t i = 0; i < entries->length; i++) {
+      if (state[i] == MATCHED)
+        vec_push_TryEntryPtr(rest, &entries->data[i]);
+    }
+  }
+
+  Z_FREE(heap.items);
+  Z_FREE(cands.items);
+  Z_FREE(state);
+  return res;
+}
+
+// ============================================================================
+// Engine selection
+// ============================================================================
+
+// Owned by the thread calling filter_rank()/filter_narrow()
+static FilterEngine current_engine = FILTER_SERIAL;
+static double cost_per_entry_ms = 0; // Moving average, single-thread work
+static int parallel_threads = 0;     // 0 = not looked up yet
+
+static int available_threads(void) {
+  if (parallel_threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    parallel_threads = cpus < 1 ? 1 : cpus > FILTER_MAX_THREADS ? FILTER_MAX_THREADS : (int)cpus;
+  }
+  return parallel_threads;
+}
+
+// Pick an engine for a pool from the measured cost per entry. Moving up a
+// tier takes the predicted cost crossing its threshold, moving down takes it
+// falling under half of it, so a root near a threshold doesn't flap.
+static FilterEngine choose_engine(size_t pool) {
+  double predicted = (double)pool * cost_per_entry_ms;
+  if (cost_per_entry_ms == 0)
+    predicted = pool > FILTER_SERIAL_MAX_ENTRIES ? FILTER_SERIAL_MAX_MS * 2 : 0;
+
+  FilterEngine e = current_engine;
+  if (e == FILTER_SERIAL && predicted > FILTER_SERIAL_MAX_MS)
+    e = FILTER_PREFILTER;
+  if (e == FILTER_PREFILTER && predicted > FILTER_PARALLEL_MIN_MS)
+    e = FILTER_PARALLEL;
+  if (e == FILTER_PARALLEL && predicted < FILTER_PARALLEL_MIN_MS / 2)
+    e = FILTER_PREFILTER;
+  if (e == FILTER_PREFILTER && predicted < FILTER_SERIAL_MAX_MS / 2)
+    e = FILTER_SERIAL;
+
+  // Splitting needs a second core and enough entries to go around
+  if (e == FILTER_PARALLEL && (available_threads() < 2 || pool < 2 * FILTER_MIN_CHUNK))
+    e = FILTER_PREFILTER;
+
+  if (e != current_engine) {
+    try_stats.engine_switches++;
+    current_engine = e;
+  }
+  return e;
+}
+
+static int threads_for(size_t entries) {
+  size_t by_size = entries / FILTER_MIN_CHUNK;
+  int threads = available_threads();
+  return by_size < (size_t)threads ? (by_size < 1 ? 1 : (int)by_size) : threads;
+}
+
+static void observe_cost(FilterResult res, size_t pool, double work_ms) {
+  if (pool == 0)
+    return;
+  try_stats.engine_passes[res.engine]++;
+  if (res.truncated)
+    return; // A cut-short pass under-reports
+  double sample = work_ms / (double)pool;
+  cost_per_entry_ms = cost_per_entry_ms == 0 ? sample : 0.7 * cost_per_entry_ms + 0.3 * sample;
+  try_stats.engine_cost_ns = cost_per_entry_ms * 1e6;
+}
+
+static FilterResult rank_adaptive(vec_TryEntry *entries, const vec_TryEntryPtr *candidates,
+                                  const char *query, size_t limit, double budget_ms,
+                                  vec_RankedEntry *ranked, vec_TryEntryPtr *rest) {
+  size_t pool = candidates ? candidates->length : entries->length;
+  FilterEngine engine = choose_engine(pool);
+  int threads = engine == FILTER_PARALLEL ? threads_for(entries->length) : 1;
+  double work_ms;
+  FilterResult res = rank_entries(entries, candidates, query, limit, budget_ms, engine,
+                                  threads, ranked, rest, NULL, &work_ms);
+  observe_cost(res, pool, work_ms);
+  return res;
+}
+
+FilterResult filter_rank_detached(vec_TryEntry *entries, const char *query,
+                                  size_t limit, vec_RankedEntry *ranked,
+                                  vec_TryEntryPtr *rest, const atomic_bool *cancel) {
+  return rank_entries(entries, NULL, query, limit, 0, FILTER_PREFILTER, 1, ranked, rest,
+                      cancel, NULL);
+}
+
+void filter_apply(const vec_RankedEntry *ranked, const vec_TryEntryPtr *rest,
+                  const char *query, vec_TryEntryPtr *out) {
+  ALLOC_PHASE(ALLOC_FUZZY);
+  vec_clear_TryEntryPtr(out);
+  for (size_t i = 0; i < ranked->length; i++) {
+    TryEntry *entry = ranked->data[i].entry;
+    entry->score = ranked->data[i].score;
+    fuzzy_render(entry, query);
+    vec_push_TryEntryPtr(out, entry);
+  }
+  for (size_t i = 0; i < rest->length; i++) {
+    rest->data[i]->score = 0.0;
+    vec_push_TryEntryPtr(out, rest->data[i]);
+  }
+}
+
+FilterResult filter_rank(vec_TryEntry *entries, const char *query, size_t limit,
+                         double budget_ms, vec_TryEntryPtr *out) {
+  vec_RankedEntry ranked = {0};
+  vec_TryEntryPtr rest = {0};
+  FilterResult res = rank_adaptive(entries, NULL, query, limit, budget_ms, &ranked, &rest);
+  filter_apply(&ranked, &rest, query, out);
+  vec_free_RankedEntry(&ranked);
+  vec_free_TryEntryPtr(&rest);
+  return res;
+}
+
+FilterResult filter_narrow(vec_TryEntry *entries, const vec_TryEntryPtr *candidates,
+                           const char *query, size_t limit, double budget_ms,
+                           vec_TryEntryPtr *out) {
+  vec_RankedEntry ranked = {0};
+  vec_TryEntryPtr rest = {0};
+  FilterResult res =
+      rank_adaptive(entries, candidates, query, limit, budget_ms, &ranked, &rest);
+  filter_apply(&ranked, &rest, query, out);
+  vec_free_RankedEntry(&ranked);
+  vec_free_TryEntryPtr(&rest);
+  return res;
+}
+
+void filter_rank_batch(vec_TryEntry *entries, const char *const *queries,
+                       size_t query_count, size_t limit, vec_RankedEntry *outs) {
+  ALLOC_PHASE(ALLOC_FUZZY);
+  for (size_t q = 0; q < query_count; q++)
+    vec_clear_RankedEntry(&outs[q]);
+  if (entries->length == 0 || query_count == 0)
+    return;
+
+  if (limit == 0 || limit > entries->length)
+    limit = entries->length;
+
+  TopK *heaps = Z_CALLOC(query_count, sizeof(TopK));
+  if (!heaps)
+    return;
+  for (size_t q = 0; q < query_count; q++) {
+    heaps[q].limit = limit;
+    heaps[q].items = Z_MALLOC(limit * sizeof(RankedEntry));
+    if (!heaps[q].items)
+      heaps[q].limit = 0;
+  }
+  time_t now = time(NULL);
+  LearnBoosts *boosts = Z_CALLOC(query_count, sizeof(LearnBoosts));
+  if (!boosts) {
+    for (size_t q = 0; q < query_count; q++)
+      Z_FREE(heaps[q].items);
+    Z_FREE(heaps);
+    return;
+  }
+  for (size_t q = 0; q < query_count; q++)
+    learn_lookup(queries[q], &boosts[q]);
+
+  // Entry-major: each name is pulled into cache once and tested against
+  // every query while it's hot
+  for (size_t i = 0; i < entries->length; i++) {
+    TryEntry *entry = &entries->data[i];
+    for (size_t q = 0; q < query_count; q++) {
+      float bound;
+      bool pruned;
+      TryEntry *evicted;
+      if (heaps[q].limit == 0 || !fuzzy_bound(entry, queries[q], now, &bound))
+        continue;
+      float bonus = job_bonus(&boosts[q], entry);
+      topk_offer(&heaps[q], entry, bound + bonus, bonus, queries[q], now, &pruned, &evicted);
+    }
+  }
+
+  for (size_t q = 0; q < query_count; q++) {
+    topk_sort(&heaps[q]);
+    for (size_t i = 0; i < heaps[q].length; i++)
+      vec_push_RankedEntry(&outs[q], heaps[q].items[i]);
+    Z_FREE(heaps[q].items);
+  }
+  Z_FREE(heaps);
+  Z_FREE(boosts);
+}
@@ -0,0 +1,74 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "tui.h" // Need full definition of TryEntry
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// How a pass was ranked. filter_rank() and filter_narrow() pick one per call
+// from the cost they measured on earlier calls.
+typedef enum {
+  FILTER_SERIAL,    // Score matches in one pass (small pools)
+  FILTER_PREFILTER, // Bound every match, then refine the top K
+  FILTER_PARALLEL,  // The bounding pass split over threads
+  FILTER_ENGINE_COUNT
+} FilterEngine;
+
+typedef struct {
+  size_t matched; // Entries matching the query (length of out)
+  size_t ranked;  // Leading entries of out that are scored, sorted and rendered
+  size_t pruned;  // Matches never scored exactly (bound couldn't rank, or out of budget)
+  bool truncated; // Refinement ran out of budget: some ranked scores are upper bounds
+  FilterEngine engine;
+} FilterResult;
+
+// One ranked hit. Scores live here rather than in the entry so ranking can
+// run without touching the entries (batch queries, background threads).
+typedef struct {
+  TryEntry *entry;
+  float score;
+} RankedEntry;
+
+Z_VEC_GENERATE_IMPL(RankedEntry, RankedEntry)
+
+// Rank entries against query into out (cleared first). Only the best `limit`
+// matches are fully scored, sorted and rendered; the remaining matches follow
+// them in scan order with a score of 0. limit == 0 ranks every match.
+// Equal scores keep scan order, so a bigger limit never reorders the prefix.
+// Scores include the bonus learned for the query (see learn.h), if any.
+//
+// Every match is found by a cheap bounding pass; exact scoring of the top
+// `limit` then stops after budget_ms (0 = no limit), ranking what's left by
+// bound and setting truncated. Rank again without a budget to refine. The
+// bounding pass always runs to the end (filter_narrow() relies on every
+// match being found), so a call can overrun budget_ms by its cost.
+FilterResult filter_rank(vec_TryEntry *entries, const char *query, size_t limit,
+                         double budget_ms, vec_TryEntryPtr *out);
+
+// filter_rank() restricted to candidates, which must hold every match of a
+// query that `query` extends: matching is by subsequence, so typing more can
+// only drop matches. candidates may be out itself.
+FilterResult filter_narrow(vec_TryEntry *entries, const vec_TryEntryPtr *candidates,
+                           const char *query, size_t limit, double budget_ms,
+                           vec_TryEntryPtr *out);
+
+// The ranking half of filter_rank(). Reads only names and mtimes, so it may
+// run on another thread while the entries are rendered. ranked receives the
+// top `limit` best first, rest the other matches in scan order. Stops early
+// (with partial results) once *cancel is set; cancel may be NULL.
+FilterResult filter_rank_detached(vec_TryEntry *entries, const char *query,
+                                  size_t limit, vec_RankedEntry *ranked,
+                                  vec_TryEntryPtr *rest, const atomic_bool *cancel);
+
+// The publishing half: store scores, render the ranked entries, fill out
+void filter_apply(const vec_RankedEntry *ranked, const vec_TryEntryPtr *rest,
+                  const char *query, vec_TryEntryPtr *out);
+
+// Rank several queries in a single pass over entries, keeping a top-`limit`
+// heap per query (limit == 0 keeps every match). outs[i] receives the hits
+// for queries[i], best first; entries themselves are left untouched.
+void filter_rank_batch(vec_TryEntry *entries, const char *const *queries,
+                       size_t query_count, size_t limit, vec_RankedEntry *outs);
+
+#endif // FILTER_H
@@ -1,8 +1,8 @@
 #include "fuzzy.h"
 #include "tui.h"
-#include "tui.h"
 #include <ctype.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -15,19 +15,224 @@ static bool has_date_prefix(const char *text) {
           isdigit(text[8]) && isdigit(text[9]) && text[10] == '-');
 }
 
-void fuzzy_match(TryEntry *entry, const char *query) {
-  // Reset score
-  entry->score = 0.0;
+// Access time bonus - recently accessed is better (matches Ruby reference)
+static double recency_bonus(time_t mtime, time_t now) {
+  double hours_since_access = difftime(now, mtime) / 3600.0;
+  return 3.0 / sqrt(hours_since_access + 1);
+}
+
+static inline char lower(char c) { return (char)tolower((unsigned char)c); }
+
+// ============================================================================
+// Tables
+// ============================================================================
+
+// Names up to this length score from the tables; longer ones (only possible
+// through calculate_score) fall back to computing each term
+#define FUZZY_TABLE_LEN 256
+
+static unsigned char fold[256];        // tolower() in the C locale
+static bool word_byte[256];            // isalnum() in the C locale
+static double proximity[FUZZY_TABLE_LEN]; // 2 / sqrt(gap + 1)
+static double length_penalty[FUZZY_TABLE_LEN + 1]; // 10 / (len + 10)
+static float density[3][FUZZY_TABLE_LEN + 1];     // n / (last_pos + 1), n = 1..3
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+// Every entry is computed with the same expression (and types) as the
+// formula it replaces, so scores stay bit-for-bit identical
+static void init_tables(void) {
+  for (int c = 0; c < 256; c++) {
+    fold[c] = (unsigned char)((c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+    word_byte[c] = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+  }
+  for (int gap = 0; gap < FUZZY_TABLE_LEN; gap++)
+    proximity[gap] = 2.0 / sqrt(gap + 1);
+  for (int len = 0; len <= FUZZY_TABLE_LEN; len++)
+    length_penalty[len] = 10.0 / (len + 10.0);
+  for (int n = 1; n <= 3; n++) {
+    for (int end = 1; end <= FUZZY_TABLE_LEN; end++)
+      density[n - 1][end] = (float)n / end;
+  }
+}
+
+static inline void ensure_tables(void) { pthread_once(&tables_once, init_tables); }
+
+static inline double proximity_bonus(int gap) {
+  return gap < FUZZY_TABLE_LEN ? proximity[gap] : 2.0 / sqrt(gap + 1);
+}
+
+static inline double length_factor(size_t len) {
+  return len <= FUZZY_TABLE_LEN ? length_penalty[len] : 10.0 / (len + 10.0);
+}
+
+// ============================================================================
+// Kernels
+// ============================================================================
+
+/*
+ * FUZZY_GENERATE_KERNEL(Name, N) defines
+ *
+ *   int fuzzy_kernel_Name(const unsigned char *text, size_t len,
+ *                         const unsigned char *query, int n, float *score)
+ *
+ * which matches the N query characters greedily (case-insensitively) and
+ * sums their bonuses into *score, before the density and length multipliers.
+ * Returns the position of the last match, or -1 if the query doesn't match.
+ * With a constant N the compiler unrolls the query loop; the generic kernel
+ * passes N = n.
+ */
+#define FUZZY_GENERATE_KERNEL(Name, N)                                          \
+  static inline int fuzzy_kernel_##Name(const unsigned char *text, size_t len,  \
+                                        const unsigned char *query, int n,      \
+                                        float *score) {                         \
+    (void)n;                                                                    \
+    float fuzzy = 0.0;                                                          \
+    size_t pos = 0;                                                             \
+    int last_pos = -1;                                                          \
+    for (int k = 0; k < (N); k++) {                                             \
+      unsigned char c = fold[query[k]];                                         \
+      while (pos < len && fold[text[pos]] != c)                                 \
+        pos++;                                                                  \
+      if (pos == len)                                                           \
+        return -1;                                                              \
+      fuzzy += 1.0;                                                             \
+      /* Word boundary bonus */                                                 \
+      if (pos == 0 || !word_byte[text[pos - 1]])                                \
+        fuzzy += 1.0;                                                           \
+      /* Proximity bonus (bumped to favor consecutive matches) */               \
+      if (last_pos >= 0)                                                        \
+        fuzzy += proximity_bonus((int)pos - last_pos - 1);                      \
+      last_pos = (int)pos++;                                                    \
+    }                                                                           \
+    *score = fuzzy;                                                             \
+    return last_pos;                                                            \
+  }
+
+FUZZY_GENERATE_KERNEL(1, 1)
+FUZZY_GENERATE_KERNEL(2, 2)
+FUZZY_GENERATE_KERNEL(3, 3)
+FUZZY_GENERATE_KERNEL(n, n)
+
+float fuzzy_score(const TryEntry *entry, const char *query, time_t now) {
+  float score = 0.0;
+
+  // No query: time-based scoring only
+  if (!query || !*query) {
+    score += recency_bonus(entry->mtime, now);
+    return score;
+  }
+
+  ensure_tables();
+  const unsigned char *text = (const unsigned char *)entry->name.data;
+  size_t text_len = entry->name.len;
+  const unsigned char *q = (const unsigned char *)query;
+  int query_len = (int)strlen(query);
+
+  // Track fuzzy match score separately
+  float fuzzy_score;
+  int last_pos;
+  switch (query_len) {
+  case 1:
+    last_pos = fuzzy_kernel_1(text, text_len, q, 1, &fuzzy_score);
+    break;
+  case 2:
+    last_pos = fuzzy_kernel_2(text, text_len, q, 2, &fuzzy_score);
+    break;
+  case 3:
+    last_pos = fuzzy_kernel_3(text, text_len, q, 3, &fuzzy_score);
+    break;
+  default:
+    last_pos = fuzzy_kernel_n(text, text_len, q, query_len, &fuzzy_score);
+    break;
+  }
+
+  // If we didn't match the full query, score is 0 (filter out)
+  if (last_pos < 0) {
+    return 0.0;
+  }
+
+  // Apply multipliers only to fuzzy match score
+  // Density bonus
+  if (query_len <= 3 && last_pos < FUZZY_TABLE_LEN)
+    fuzzy_score *= density[query_len - 1][last_pos + 1];
+  else
+    fuzzy_score *= ((float)query_len / (last_pos + 1));
+
+  // Length penalty
+  fuzzy_score *= length_factor(text_len);
+
+  // Date prefix bonus (applied after multipliers to avoid crushing)
+  float date_bonus = 0.0;
+  if (has_date_prefix(entry->name.data)) {
+    date_bonus = 2.0;
+  }
+
+  // Now add contextual bonuses (not affected by multipliers)
+  score = fuzzy_score + date_bonus;
+  score += recency_bonus(entry->mtime, now);
+  return score;
+}
+
+bool fuzzy_bound(const TryEntry *entry, const char *query, time_t now,
+                 float *bound) {
+  if (!query || !*query) {
+    *bound = fuzzy_score(entry, query, now);
+    return true;
+  }
 
+  ensure_tables();
+  const unsigned char *text = (const unsigned char *)entry->name.data;
+  size_t text_len = entry->name.len;
+  int query_len = 0;
+  int last_pos = -1;
+
+  size_t pos = 0;
+  for (const unsigned char *q = (const unsigned char *)query; *q; q++, pos++) {
+    unsigned char c = fold[*q];
+    while (pos < text_len && fold[text[pos]] != c)
+      pos++;
+    if (pos == text_len)
+      return false;
+    last_pos = (int)pos;
+    query_len++;
+  }
+
+  // Every match at best earns 1 + word boundary 1 + gap-free proximity 2
+  // (no proximity for the first). fuzzy_score() matches greedily too, so
+  // last_pos and therefore both multipliers are exact.
+  double fuzzy = 4.0 * query_len - 2.0;
+  fuzzy *= (double)query_len / (last_pos + 1);
+  fuzzy *= length_factor(text_len);
+
+  double date_bonus = has_date_prefix(entry->name.data) ? 2.0 : 0.0;
+
+  // Small slack covers float rounding in the exact computation
+  *bound = (float)(fuzzy + date_bonus + recency_bonus(entry->mtime, now) + 1e-3);
+  return true;
+}
+
+int fuzzy_match_end(const TryEntry *entry, const char *query) {
+  const char *text = entry->name.data;
+  int pos = 0;
+  for (const char *q = query ? query : ""; *q; q++, pos++) {
+    while (text[pos] && lower(text[pos]) != lower(*q))
+      pos++;
+    if (!text[pos])
+      return -1;
+  }
+  return pos;
+}
+
+void fuzzy_render(TryEntry *entry, const char *query) {
   // Style string for proper nesting (dark date section + match highlights)
   TuiStyleString ss = tui_start_zstr(&entry->rendered);
 
-  const char *text = zstr_cstr(&entry->name);
+  const char *text = entry->name.data;
+  bool has_date = has_date_prefix(text);
 
-  // 2. If no query, just render with dimmed date prefix
+  // If no query, just render with dimmed date prefix
   if (!query || !*query) {
-    // Check for date prefix and render with dimming
-    if (has_date_prefix(text)) {
+    if (has_date) {
       // Render date prefix (YYYY-MM-DD-) with dark color, including the trailing dash
       tui_push(&ss, TUI_DARK);
       zstr_cat_len(&entry->rendered, text, 11); // Date + dash is 11 chars
@@ -36,135 +241,48 @@ void fuzzy_match(TryEntry *entry, const char *query) {
     } else {
       zstr_cat(&entry->rendered, text);
     }
-    // Time-based scoring (matches Ruby reference)
-    time_t now = time(NULL);
-    double hours_since_access = difftime(now, entry->mtime) / 3600.0;
-    entry->score += 3.0 / sqrt(hours_since_access + 1);
     return;
   }
 
-  // 3. Fuzzy match with highlighting
-  // We need lower-case versions for case-insensitive matching
-  Z_CLEANUP(zstr_free) zstr text_lower = zstr_from(text);
-  Z_CLEANUP(zstr_free) zstr query_lower = zstr_from(query);
-
-  // In-place tolower
-  char *text_data = zstr_data(&text_lower);
-  char *query_data = zstr_data(&query_lower);
-  for (size_t i = 0; i < zstr_len(&text_lower); i++)
-    text_data[i] = tolower(text_data[i]);
-  for (size_t i = 0; i < zstr_len(&query_lower); i++)
-    query_data[i] = tolower(query_data[i]);
-
-  const char *t_ptr = text_data;
-  const char *q_ptr = query_data;
-  const char *orig_ptr = text;
-
-  int query_len = zstr_len(&query_lower);
+  // Fuzzy match with highlighting (case-insensitive)
+  int query_len = (int)strlen(query);
   int query_idx = 0;
-  int last_pos = -1;
-  int current_pos = 0;
-  bool has_date = has_date_prefix(text);
-  bool in_date_section = false;
-
-  // Track fuzzy match score separately
-  float fuzzy_score = 0.0;
 
-  while (*t_ptr) {
+  for (int pos = 0; text[pos]; pos++) {
     // Handle date prefix dimming (including the trailing dash at position 10)
-    if (has_date && current_pos == 0) {
+    if (has_date && pos == 0) {
       tui_push(&ss, TUI_DARK);
-      in_date_section = true;
     }
 
-    if (query_idx < query_len && *t_ptr == q_ptr[query_idx]) {
-      // Match found!
-      fuzzy_score += 1.0;
-
-      // Word boundary bonus
-      if (current_pos == 0 || !isalnum(*(t_ptr - 1))) {
-        fuzzy_score += 1.0;
-      }
-
-      // Proximity bonus (bumped to favor consecutive matches)
-      if (last_pos >= 0) {
-        int gap = current_pos - last_pos - 1;
-        fuzzy_score += 2.0 / sqrt(gap + 1);
-      }
-
-      last_pos = current_pos;
+    if (query_idx < query_len && lower(text[pos]) == lower(query[query_idx])) {
       query_idx++;
-
       // Append highlighted char (yellow fg, preserves dark if in date section)
       tui_push(&ss, TUI_MATCH);
-      tui_putc(&ss, *orig_ptr);
+      tui_putc(&ss, text[pos]);
       tui_pop(&ss);
     } else {
       // No match, append regular char
-      tui_putc(&ss, *orig_ptr);
+      tui_putc(&ss, text[pos]);
     }
 
     // Close dim section after the trailing dash (position 10)
-    if (has_date && current_pos == 10 && in_date_section) {
+    if (has_date && pos == 10) {
       tui_pop(&ss);
-      in_date_section = false;
     }
-
-    t_ptr++;
-    orig_ptr++;
-    current_pos++;
   }
+}
 
-  // If we didn't match the full query, score is 0 (filter out)
-  if (query_idx < query_len) {
-    entry->score = 0.0;
-    // Keep the rendered string as is (it will be filtered out anyway)
-    return;
-  }
-
-  // Apply multipliers only to fuzzy match score
-  // Density bonus
-  if (last_pos >= 0) {
-    fuzzy_score *= ((float)query_len / (last_pos + 1));
-  }
-
-  // Length penalty
-  int text_len = zstr_len(&entry->name);
-  fuzzy_score *= (10.0 / (text_len + 10.0));
-
-  // Date prefix bonus (applied after multipliers to avoid crushing)
-  float date_bonus = 0.0;
-  if (has_date_prefix(text)) {
-    date_bonus = 2.0;
-  }
-
-  // Now add contextual bonuses (not affected by multipliers)
-  entry->score = fuzzy_score + date_bonus;
-
-  // Time-based scoring (matches Ruby reference implementation)
-  time_t now = time(NULL);
-
-  // Access time bonus - recently accessed is better
-  double hours_since_access = difftime(now, entry->mtime) / 3600.0;
-  entry->score += 3.0 / sqrt(hours_since_access + 1);
+void fuzzy_match(TryEntry *entry, const char *query) {
+  entry->score = fuzzy_score(entry, query, time(NULL));
+  fuzzy_render(entry, query);
 }
 
 float calculate_score(const char *text, const char *query, time_t mtime) {
   // Convenience wrapper using the new logic
   // We create a temporary entry just for scoring
   TryEntry tmp = {0};
-  tmp.name = zstr_from(text);
-  tmp.rendered = zstr_init();
-  tmp.path = zstr_init();
+  tmp.name = zstr_view_from(text);
   tmp.mtime = mtime;
 
-  fuzzy_match(&tmp, query);
-
-  float score = tmp.score;
-
-  zstr_free(&tmp.name);
-  zstr_free(&tmp.rendered);
-  zstr_free(&tmp.path);
-
-  return score;
+  return fuzzy_score(&tmp, query, time(NULL));
 }
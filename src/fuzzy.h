@@ -8,6 +8,24 @@
 // Rendered string contains ANSI codes for highlighting matched characters
 void fuzzy_match(TryEntry *entry, const char *query);
 
+// Score only (no rendering): the value fuzzy_match() stores in entry->score,
+// with `now` as the reference for recency. 0 if the query doesn't match.
+float fuzzy_score(const TryEntry *entry, const char *query, time_t now);
+
+// Render only: highlight matches in entry->rendered, leave the score alone
+void fuzzy_render(TryEntry *entry, const char *query);
+
+// Cheap pre-pass for ranking: subsequence test plus an upper bound on
+// fuzzy_score(). The greedy match position fixes the density and length
+// factors and the date/recency terms are exact, so only the per-character
+// bonuses are over-estimated. Returns false if the query doesn't match.
+bool fuzzy_bound(const TryEntry *entry, const char *query, time_t now,
+                 float *bound);
+
+// End of the greedy match of query in entry->name (index just past the last
+// matched character; 0 for an empty query), or -1 if it doesn't match
+int fuzzy_match_end(const TryEntry *entry, const char *query);
+
 // Legacy/Convenience: just calculate score (read-only)
 float calculate_score(const char *text, const char *query, time_t mtime);
 
@@ -0,0 +1,296 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "ignore.h"
+#include "config.h"
+#include "utils.h"
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/*
+ * Compiled program: a flat list of rules, each
+ *
+ *   u8 flags, u8 kind, u16 len, len pattern bytes
+ *
+ * Rules are classified at compile time so the common shapes (`name`,
+ * `*.ext`, `prefix*`) are a single compare and only real globs go through
+ * the matcher. Being plain bytes, the program is stored as-is in the index.
+ */
+
+enum {
+  RULE_NEGATE = 1,   // `!pattern`: re-include
+  RULE_DIR_ONLY = 2, // `pattern/`
+  RULE_ANCHORED = 4  // Matched against the whole path, not the basename
+};
+
+enum {
+  KIND_EXACT,  // Literal name
+  KIND_SUFFIX, // `*literal`
+  KIND_PREFIX, // `literal*`
+  KIND_GLOB
+};
+
+#define RULE_HEADER 4
+
+static bool has_meta(const char *s, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (s[i] == '*' || s[i] == '?' || s[i] == '[' || s[i] == '\\')
+      return true;
+  }
+  return false;
+}
+
+static void compile_line(zstr *prog, const char *p, size_t len) {
+  // Trailing whitespace is not significant
+  while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t' || p[len - 1] == '\r'))
+    len--;
+  if (len == 0 || p[0] == '#')
+    return;
+
+  uint8_t flags = 0;
+  if (p[0] == '!') {
+    flags |= RULE_NEGATE;
+    p++;
+    len--;
+  } else if (p[0] == '\\' && len > 1 && (p[1] == '!' || p[1] == '#')) {
+    p++;
+    len--;
+  }
+  if (len > 0 && p[len - 1] == '/') {
+    flags |= RULE_DIR_ONLY;
+    len--;
+  }
+  // `**/name` matches at any depth, which is what an unanchored rule does
+  while (len > 3 && memcmp(p, "**/", 3) == 0 && !memchr(p + 3, '/', len - 3)) {
+    p += 3;
+    len -= 3;
+  }
+  if (memchr(p, '/', len))
+    flags |= RULE_ANCHORED;
+  while (len > 0 && p[0] == '/') {
+    p++;
+    len--;
+  }
+  if (len == 0 || len > UINT16_MAX)
+    return;
+
+  uint8_t kind = KIND_GLOB;
+  if (!has_meta(p, len)) {
+    kind = KIND_EXACT;
+  } else if (!(flags & RULE_ANCHORED) && p[0] == '*' && !has_meta(p + 1, len - 1)) {
+    kind = KIND_SUFFIX;
+    p++;
+    len--;
+  } else if (!(flags & RULE_ANCHORED) && p[len - 1] == '*' && !has_meta(p, len - 1)) {
+    kind = KIND_PREFIX;
+    len--;
+  }
+
+  uint16_t n = (uint16_t)len;
+  zstr_push(prog, (char)flags);
+  zstr_push(prog, (char)kind);
+  zstr_cat_len(prog, (const char *)&n, sizeof(n));
+  zstr_cat_len(prog, p, len);
+}
+
+TryIgnore ignore_compile(const char *text, size_t len) {
+  TryIgnore ig = {zstr_init()};
+  const char *end = text + len;
+  while (text < end) {
+    const char *nl = memchr(text, '\n', (size_t)(end - text));
+    const char *line_end = nl ? nl : end;
+    compile_line(&ig.program, text, (size_t)(line_end - text));
+    text = line_end + 1;
+  }
+  return ig;
+}
+
+TryIgnore ignore_load(const char *tries_path, TryIndex *idx) {
+  Z_CLEANUP(zstr_free) zstr file = join_path(tries_path, IGNORE_FILE_NAME);
+  struct stat sb;
+  if (stat(zstr_cstr(&file), &sb) != 0) {
+    if (idx->ignore_mtime != 0 || zstr_len(&idx->ignore_program) > 0) {
+      zstr_free(&idx->ignore_program);
+      idx->ignore_mtime = 0;
+      idx->ignore_size = 0;
+      idx->dirty = true;
+
+      IndexEntry *e;
+      vec_foreach(&idx->entries, e) {
+        e->size_checked = 0;
+      }
+    }
+    return (TryIgnore){zstr_init()};
+  }
+
+  if (idx->ignore_mtime != sb.st_mtime || idx->ignore_size != (uint64_t)sb.st_size) {
+    Z_CLEANUP(zstr_free) zstr text = zstr_read_file(zstr_cstr(&file));
+    TryIgnore fresh = ignore_compile(zstr_cstr(&text), zstr_len(&text));
+    zstr_free(&idx->ignore_program);
+    idx->ignore_program = fresh.program;
+    idx->ignore_mtime = sb.st_mtime;
+    idx->ignore_size = (uint64_t)sb.st_size;
+    idx->dirty = true;
+
+    // Cached sizes were summed under the old rules
+    IndexEntry *e;
+    vec_foreach(&idx->entries, e) {
+      e->size_checked = 0;
+    }
+  }
+  return (TryIgnore){zstr_dup(&idx->ignore_program)};
+}
+
+void ignore_free(TryIgnore *ig) {
+  zstr_free(&ig->program);
+}
+
+// ============================================================================
+// Matching
+// ============================================================================
+
+// `[...]` at p (p[0] == '['). Returns the end of the class, or NULL if it
+// isn't closed (then `[` is taken literally).
+static const char *match_class(const char *p, const char *pe, char c, bool *hit) {
+  const char *q = p + 1;
+  bool negate = q < pe && (*q == '!' || *q == '^');
+  if (negate)
+    q++;
+  bool found = false;
+  bool first = true;
+  while (q < pe && (*q != ']' || first)) {
+    first = false;
+    char lo = *q;
+    if (lo == '\\' && q + 1 < pe)
+      lo = *++q;
+    char hi = lo;
+    if (q + 2 < pe && q[1] == '-' && q[2] != ']') {
+      hi = q[2];
+      q += 2;
+    }
+    if (c >= lo && c <= hi)
+      found = true;
+    q++;
+  }
+  if (q >= pe)
+    return NULL;
+  *hit = found != negate;
+  return q + 1;
+}
+
+// Glob over [p, pe) against [s, se). `*` and `?` stop at `/`; `**` doesn't.
+static bool glob_match(const char *p, const char *pe, const char *s, const char *se) {
+  while (p < pe) {
+    if (p[0] == '*' && p + 1 < pe && p[1] == '*') {
+      p += 2;
+      if (p < pe && *p == '/') {
+        // `**/`: zero or more whole directories
+        p++;
+        for (const char *t = s;;) {
+          if (glob_match(p, pe, t, se))
+            return true;
+          while (t < se && *t != '/')
+            t++;
+          if (t == se)
+            return false;
+          t++;
+        }
+      }
+      for (const char *t = s; t <= se; t++) {
+        if (glob_match(p, pe, t, se))
+          return true;
+      }
+      return false;
+    }
+    if (p[0] == '*') {
+      for (const char *t = s;; t++) {
+        if (glob_match(p + 1, pe, t, se))
+          return true;
+        if (t == se || *t == '/')
+          return false;
+      }
+    }
+    if (s == se)
+      return false;
+    if (p[0] == '?') {
+      if (*s == '/')
+        return false;
+    } else if (p[0] == '[') {
+      bool hit;
+      const char *next = match_class(p, pe, *s, &hit);
+      if (next) {
+        if (!hit || *s == '/')
+          return false;
+        p = next;
+        s++;
+        continue;
+      }
+      if (*s != '[')
+        return false;
+    } else {
+      if (p[0] == '\\' && p + 1 < pe)
+        p++;
+      if (*p != *s)
+        return false;
+    }
+    p++;
+    s++;
+  }
+  return s == se;
+}
+
+bool ignore_match(const TryIgnore *ig, const char *relpath, bool is_dir) {
+  const char *prog = zstr_cstr(&ig->program);
+  const char *prog_end = prog + zstr_len(&ig->program);
+  if (prog == prog_end)
+    return false;
+
+  size_t path_len = strlen(relpath);
+  const char *base = strrchr(relpath, '/');
+  base = base ? base + 1 : relpath;
+  size_t base_len = path_len - (size_t)(base - relpath);
+
+  // Last matching rule wins, as in gitignore
+  bool ignored = false;
+  while (prog_end - prog >= RULE_HEADER) {
+    uint8_t flags = (uint8_t)prog[0];
+    uint8_t kind = (uint8_t)prog[1];
+    uint16_t n;
+    memcpy(&n, prog + 2, sizeof(n));
+    const char *pat = prog + RULE_HEADER;
+    if ((size_t)(prog_end - pat) < n)
+      break; // Damaged program
+    prog = pat + n;
+
+    if ((flags & RULE_DIR_ONLY) && !is_dir)
+      continue;
+    if (ignored == !(flags & RULE_NEGATE))
+      continue; // Can't change the outcome
+
+    const char *s = (flags & RULE_ANCHORED) ? relpath : base;
+    size_t len = (flags & RULE_ANCHORED) ? path_len : base_len;
+    bool hit;
+    switch (kind) {
+    case KIND_EXACT:
+      hit = len == n && memcmp(s, pat, n) == 0;
+      break;
+    case KIND_SUFFIX:
+      hit = len >= n && memcmp(s + len - n, pat, n) == 0;
+      break;
+    case KIND_PREFIX:
+      hit = len >= n && memcmp(s, pat, n) == 0;
+      break;
+    default:
+      hit = glob_match(pat, pat + n, s, s + len);
+      break;
+    }
+    if (hit)
+      ignored = !(flags & RULE_NEGATE);
+  }
+  return ignored;
+}
@@ -0,0 +1,37 @@
+#ifndef IGNORE_H
+#define IGNORE_H
+
+#include "index.h"
+#include "libs/zstr.h"
+#include <stdbool.h>
+
+// Gitignore-style rules from IGNORE_FILE_NAME in the tries root. Matching
+// tries are hidden from the scan, and matching subtrees are skipped by
+// deep walks (disk usage) before they are stat()ed or opened.
+//
+// Supported syntax: blank lines and `#` comments, `!` to re-include, a
+// trailing `/` for directories only, a leading or inner `/` to anchor the
+// pattern to the tries root, and `*`, `?`, `[...]` and `**` globs.
+
+typedef struct {
+  zstr program;   // Compiled rules; empty = nothing is ignored
+} TryIgnore;
+
+// Compile the text of an ignore file
+TryIgnore ignore_compile(const char *text, size_t len);
+
+// Rules for tries_path. The compiled program is cached in idx, keyed by the
+// ignore file's mtime and size, and only recompiled when it changes.
+TryIgnore ignore_load(const char *tries_path, TryIndex *idx);
+
+// True if relpath (relative to the tries root, `/`-separated, e.g.
+// "2025-01-01-foo/node_modules") is ignored
+bool ignore_match(const TryIgnore *ig, const char *relpath, bool is_dir);
+
+static inline bool ignore_empty(const TryIgnore *ig) {
+  return zstr_len(&ig->program) == 0;
+}
+
+void ignore_free(TryIgnore *ig);
+
+#endif // IGNORE_H
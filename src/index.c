@@ -0,0 +1,458 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "index.h"
+#include "config.h"
+#include "libs/zvec_sort.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * On-disk format (native endianness - the index is a local cache and is
+ * simply rebuilt if it doesn't parse):
+ *
+ *   "TRYIDX" u16 version u32 count
+ *   count x { u16 name_len, name bytes, u64 dev, u64 ino, i64 mtime,
+ *             u64 size_bytes, i64 size_checked, u8 git, i64 git_checked,
+ *             i64 stale_until }
+ *   i64 ignore_mtime, u64 ignore_size, u32 program_len, program bytes
+ *   [u16 cursor_len, cursor bytes]
+ *
+ * The maintenance cursor is optional: indexes written before it existed
+ * simply end after the ignore program.
+ *
+ * Selector actions don't rewrite the index; they append to a journal next
+ * to it (INDEX_FILE_NAME INDEX_JOURNAL_SUFFIX) that index_load() replays:
+ *
+ *   { u8 op, u16 name_len, name bytes [, u16 new_len, new name bytes] }
+ *
+ * Replaying a record twice is harmless, so the journal only needs to be
+ * removed once a saved index includes it.
+ *
+ * The index is mapped rather than read, and entry names are views into the
+ * mapping: loading allocates the entry array and nothing per entry. Saves
+ * replace the file by rename(), so a mapping never changes underneath.
+ */
+
+#define INDEX_MAGIC "TRYIDX"
+#define INDEX_VERSION 4
+// Smallest entry on disk: name_len and the fixed fields, with an empty name
+#define INDEX_MIN_RECORD (sizeof(uint16_t) + 7 * sizeof(uint64_t) + sizeof(uint8_t))
+
+// Named so `const T *` in the generators is a pointer to a const pointer
+typedef IndexEntry *IndexEntryRef;
+
+Z_VEC_GENERATE_SORT(IndexEntryRef, IndexByName, view_cmp((*a)->name, (*b)->name) < 0)
+
+typedef struct {
+  const char *p;
+  const char *end;
+  bool ok;
+} Reader;
+
+static void read_bytes(Reader *r, void *out, size_t n) {
+  if (!r->ok || (size_t)(r->end - r->p) < n) {
+    r->ok = false;
+    memset(out, 0, n);
+    return;
+  }
+  memcpy(out, r->p, n);
+  r->p += n;
+}
+
+static void write_bytes(zstr *s, const void *data, size_t n) {
+  zstr_cat_len(s, (const char *)data, n);
+}
+
+static void read_name(Reader *r, zstr *out) {
+  uint16_t len;
+  read_bytes(r, &len, sizeof(len));
+  if (!r->ok || (size_t)(r->end - r->p) < len) {
+    r->ok = false;
+    return;
+  }
+  *out = zstr_from_len(r->p, len);
+  r->p += len;
+}
+
+static TryIndex load_main(const char *tries_path) {
+  TryIndex idx = {0};
+  idx.file = join_path(tries_path, INDEX_FILE_NAME);
+  idx.journal = zstr_dup(&idx.file);
+  zstr_cat(&idx.journal, INDEX_JOURNAL_SUFFIX);
+
+  int fd = open(zstr_cstr(&idx.file), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return idx;
+  struct stat sb;
+  if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+    void *map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      idx.map = map;
+      idx.map_len = (size_t)sb.st_size;
+    }
+  }
+  close(fd);
+  if (!idx.map)
+    return idx;
+
+  Reader r = {idx.map, idx.map + idx.map_len, true};
+
+  char magic[sizeof(INDEX_MAGIC) - 1];
+  uint16_t version;
+  uint32_t count;
+  read_bytes(&r, magic, sizeof(magic));
+  read_bytes(&r, &version, sizeof(version));
+  read_bytes(&r, &count, sizeof(count));
+  if (!r.ok || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 ||
+      version != INDEX_VERSION) {
+    return idx; // Unknown format - start over
+  }
+
+  // The count comes from the file: a corrupt one must not reserve more
+  // entries than the rest of the mapping could hold
+  size_t fits = (size_t)(r.end - r.p) / INDEX_MIN_RECORD;
+  vec_reserve_IndexEntry(&idx.entries, count < fits ? count : fits);
+  for (uint32_t i = 0; i < count && r.ok; i++) {
+    uint16_t name_len;
+    int64_t mtime, size_checked, git_checked, stale_until;
+    uint64_t size_bytes;
+    uint8_t git;
+
+    read_bytes(&r, &name_len, sizeof(name_len));
+    if (!r.ok || (size_t)(r.end - r.p) < name_len) {
+      r.ok = false;
+      break;
+    }
+    IndexEntry e = {0};
+    e.name = (zstr_view){r.p, name_len};
+    r.p += name_len;
+
+    read_bytes(&r, &e.dev, sizeof(e.dev));
+    read_bytes(&r, &e.ino, sizeof(e.ino));
+    read_bytes(&r, &mtime, sizeof(mtime));
+    read_bytes(&r, &size_bytes, sizeof(size_bytes));
+    read_bytes(&r, &size_checked, sizeof(size_checked));
+    read_bytes(&r, &git, sizeof(git));
+    read_bytes(&r, &git_checked, sizeof(git_checked));
+    read_bytes(&r, &stale_until, sizeof(stale_until));
+
+    e.mtime = (time_t)mtime;
+    e.size_bytes = size_bytes;
+    e.size_checked = (time_t)size_checked;
+    e.git = git <= GIT_DIRTY ? (GitState)git : GIT_UNKNOWN;
+    e.git_checked = (time_t)git_checked;
+    e.stale_until = (time_t)stale_until;
+    vec_push_IndexEntry(&idx.entries, e);
+  }
+
+  // Compiled .tryignore (see ignore.h)
+  int64_t ignore_mtime;
+  uint32_t program_len;
+  read_bytes(&r, &ignore_mtime, sizeof(ignore_mtime));
+  read_bytes(&r, &idx.ignore_size, sizeof(idx.ignore_size));
+  read_bytes(&r, &program_len, sizeof(program_len));
+  if (r.ok && (size_t)(r.end - r.p) >= program_len) {
+    idx.ignore_mtime = (time_t)ignore_mtime;
+    idx.ignore_program = zstr_from_len(r.p, program_len);
+  } else {
+    r.ok = false;
+    idx.ignore_mtime = 0;
+    idx.ignore_size = 0;
+  }
+
+  // Where `try maintain` resumes (see maintain.h)
+  if (r.ok && r.p < r.end)
+    read_name(&r, &idx.maint_cursor);
+
+  if (!r.ok) {
+    // Truncated file - keep what parsed, rewrite on next save
+    idx.dirty = true;
+  }
+  return idx;
+}
+
+static void drop_entry(TryIndex *idx, const char *name) {
+  for (size_t i = 0; i < idx->entries.length; i++) {
+    if (zstr_view_eq(idx->entries.data[i].name, name)) {
+      idx->entries.data[i] = idx->entries.data[--idx->entries.length];
+      return;
+    }
+  }
+}
+
+// Returns the number of records replayed
+static size_t apply_journal(TryIndex *idx) {
+  Z_CLEANUP(zstr_free) zstr data = zstr_read_file(zstr_cstr(&idx->journal));
+  Reader r = {zstr_cstr(&data), zstr_cstr(&data) + zstr_len(&data), true};
+
+  size_t records = 0;
+  while (r.p < r.end) {
+    uint8_t op;
+    Z_CLEANUP(zstr_free) zstr name = zstr_init();
+    Z_CLEANUP(zstr_free) zstr new_name = zstr_init();
+    read_bytes(&r, &op, sizeof(op));
+    read_name(&r, &name);
+    if (op == JOURNAL_RENAME)
+      read_name(&r, &new_name);
+    if (!r.ok)
+      break; // Torn append; ignore the tail
+
+    if (op == JOURNAL_ADD) {
+      index_upsert(idx, zstr_cstr(&name));
+    } else if (op == JOURNAL_DELETE) {
+      drop_entry(idx, zstr_cstr(&name));
+    } else if (op == JOURNAL_RENAME) {
+      index_rename(idx, zstr_cstr(&name), zstr_cstr(&new_name));
+    } else {
+      break;
+    }
+    records++;
+  }
+
+  idx->journal_size = zstr_len(&data);
+  return records;
+}
+
+TryIndex index_load(const char *tries_path) {
+  TryIndex idx = load_main(tries_path);
+  bool dirty = idx.dirty;
+  size_t records = apply_journal(&idx);
+  // Replayed records alone don't need a rewrite; fold them into the index
+  // once the journal has grown
+  idx.dirty = dirty || records >= INDEX_JOURNAL_COMPACT;
+  return idx;
+}
+
+int index_journal(const char *tries_path, JournalOp op, const char *name,
+                  const char *new_name) {
+  Z_CLEANUP(zstr_free) zstr file = join_path(tries_path, INDEX_FILE_NAME);
+  zstr_cat(&file, INDEX_JOURNAL_SUFFIX);
+
+  uint8_t code = (uint8_t)op;
+  uint16_t len = (uint16_t)strlen(name);
+  Z_CLEANUP(zstr_free) zstr rec = zstr_init();
+  write_bytes(&rec, &code, sizeof(code));
+  write_bytes(&rec, &len, sizeof(len));
+  write_bytes(&rec, name, len);
+  if (op == JOURNAL_RENAME) {
+    len = (uint16_t)strlen(new_name);
+    write_bytes(&rec, &len, sizeof(len));
+    write_bytes(&rec, new_name, len);
+  }
+
+  // One O_APPEND write per record, so concurrent writers don't interleave
+  int fd = open(zstr_cstr(&file), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return -1;
+  ssize_t n = write(fd, zstr_cstr(&rec), zstr_len(&rec));
+  close(fd);
+  return n == (ssize_t)zstr_len(&rec) ? 0 : -1;
+}
+
+int index_save(TryIndex *idx) {
+  if (!idx->dirty)
+    return 0;
+
+  Z_CLEANUP(zstr_free) zstr out = zstr_init();
+  uint16_t version = INDEX_VERSION;
+  uint32_t count = (uint32_t)idx->entries.length;
+  write_bytes(&out, INDEX_MAGIC, sizeof(INDEX_MAGIC) - 1);
+  write_bytes(&out, &version, sizeof(version));
+  write_bytes(&out, &count, sizeof(count));
+
+  IndexEntry *e;
+  vec_foreach(&idx->entries, e) {
+    uint16_t name_len = (uint16_t)e->name.len;
+    int64_t mtime = e->mtime;
+    int64_t size_checked = e->size_checked;
+    int64_t git_checked = e->git_checked;
+    int64_t stale_until = e->stale_until;
+    uint8_t git = (uint8_t)e->git;
+
+    write_bytes(&out, &name_len, sizeof(name_len));
+    write_bytes(&out, e->name.data, name_len);
+    write_bytes(&out, &e->dev, sizeof(e->dev));
+    write_bytes(&out, &e->ino, sizeof(e->ino));
+    write_bytes(&out, &mtime, sizeof(mtime));
+    write_bytes(&out, &e->size_bytes, sizeof(e->size_bytes));
+    write_bytes(&out, &size_checked, sizeof(size_checked));
+    write_bytes(&out, &git, sizeof(git));
+    write_bytes(&out, &git_checked, sizeof(git_checked));
+    write_bytes(&out, &stale_until, sizeof(stale_until));
+  }
+
+  int64_t ignore_mtime = idx->ignore_mtime;
+  uint32_t program_len = (uint32_t)zstr_len(&idx->ignore_program);
+  write_bytes(&out, &ignore_mtime, sizeof(ignore_mtime));
+  write_bytes(&out, &idx->ignore_size, sizeof(idx->ignore_size));
+  write_bytes(&out, &program_len, sizeof(program_len));
+  write_bytes(&out, zstr_cstr(&idx->ignore_program), program_len);
+  if (!zstr_is_empty(&idx->maint_cursor)) {
+    uint16_t cursor_len = (uint16_t)zstr_len(&idx->maint_cursor);
+    write_bytes(&out, &cursor_len, sizeof(cursor_len));
+    write_bytes(&out, zstr_cstr(&idx->maint_cursor), cursor_len);
+  }
+
+  // Write to a temp file and rename so readers never see a partial index
+  Z_CLEANUP(zstr_free) zstr tmp = zstr_dup(&idx->file);
+  zstr_fmt(&tmp, ".%d", (int)getpid());
+
+  FILE *f = fopen(zstr_cstr(&tmp), "wb");
+  if (!f)
+    return -1;
+  size_t written = fwrite(zstr_cstr(&out), 1, zstr_len(&out), f);
+  if (fclose(f) != 0 || written != zstr_len(&out) ||
+      rename(zstr_cstr(&tmp), zstr_cstr(&idx->file)) != 0) {
+    unlink(zstr_cstr(&tmp));
+    return -1;
+  }
+
+  // The saved index includes the journal. Leave it if someone appended
+  // since we read it; replaying it again is harmless.
+  struct stat sb;
+  if (stat(zstr_cstr(&idx->journal), &sb) == 0 &&
+      (size_t)sb.st_size == idx->journal_size)
+    unlink(zstr_cstr(&idx->journal));
+
+  idx->dirty = false;
+  return 0;
+}
+
+void index_free(TryIndex *idx) {
+  vec_free_IndexEntry(&idx->entries);
+  names_free(&idx->names);
+  if (idx->map)
+    munmap((void *)idx->map, idx->map_len);
+  idx->map = NULL;
+  zstr_free(&idx->ignore_program);
+  zstr_free(&idx->maint_cursor);
+  zstr_free(&idx->journal);
+  zstr_free(&idx->file);
+}
+
+IndexEntry *index_find(TryIndex *idx, const char *name) {
+  size_t len = strlen(name);
+  IndexEntry *e;
+  vec_foreach(&idx->entries, e) {
+    if (e->name.len == len && memcmp(e->name.data, name, len) == 0)
+      return e;
+  }
+  return NULL;
+}
+
+IndexEntry *index_add(TryIndex *idx, const char *name, uint64_t dev, uint64_t ino) {
+  IndexEntry fresh = {0};
+  fresh.name = names_add(&idx->names, name, strlen(name));
+  fresh.dev = dev;
+  fresh.ino = ino;
+  vec_push_IndexEntry(&idx->entries, fresh);
+  idx->dirty = true;
+  return vec_last_IndexEntry(&idx->entries);
+}
+
+IndexEntry *index_upsert(TryIndex *idx, const char *name) {
+  IndexEntry *e = index_find(idx, name);
+  if (e)
+    return e;
+  return index_add(idx, name, 0, 0);
+}
+
+void index_sort_by_name(TryIndex *idx, vec_IndexEntryPtr *out) {
+  out->length = 0;
+  IndexEntry *e;
+  vec_foreach(&idx->entries, e) {
+    vec_push_IndexEntryPtr(out, e);
+  }
+  sort_IndexByName(out->data, out->length);
+}
+
+IndexEntry *index_lookup(const vec_IndexEntryPtr *sorted, zstr_view name) {
+  IndexEntry key = {.name = name};
+  IndexEntry *key_ptr = &key;
+  size_t at = lower_bound_IndexByName(sorted->data, sorted->length, &key_ptr);
+  if (at == sorted->length || !zstr_view_eq_view(sorted->data[at]->name, name))
+    return NULL;
+  return sorted->data[at];
+}
+
+// Give entry i a new name, dropping any other entry that had it
+static IndexEntry *rename_entry(TryIndex *idx, size_t i, const char *name) {
+  for (size_t j = 0; j < idx->entries.length; j++) {
+    if (j != i && zstr_view_eq(idx->entries.data[j].name, name)) {
+      idx->entries.data[j] = idx->entries.data[--idx->entries.length];
+      if (i == idx->entries.length)
+        i = j; // Entry i was the last one and moved into the gap
+      break;
+    }
+  }
+  IndexEntry *e = &idx->entries.data[i];
+  e->name = names_add(&idx->names, name, strlen(name));
+  idx->dirty = true;
+  return e;
+}
+
+IndexEntry *index_track(TryIndex *idx, const char *name, uint64_t dev, uint64_t ino) {
+  if (ino != 0) {
+    for (size_t i = 0; i < idx->entries.length; i++) {
+      IndexEntry *e = &idx->entries.data[i];
+      if (e->ino == ino && e->dev == dev) {
+        if (!zstr_view_eq(e->name, name))
+          e = rename_entry(idx, i, name); // Renamed since the last scan
+        return e;
+      }
+    }
+  }
+
+  IndexEntry *e = index_upsert(idx, name);
+  if (e->dev != dev || e->ino != ino) {
+    if (e->ino != 0) {
+      // Same name, different directory: nothing cached applies
+      e->size_checked = 0;
+      e->git_checked = 0;
+      e->stale_until = 0;
+    }
+    e->dev = dev;
+    e->ino = ino;
+    idx->dirty = true;
+  }
+  return e;
+}
+
+bool index_rename(TryIndex *idx, const char *old_name, const char *new_name) {
+  for (size_t i = 0; i < idx->entries.length; i++) {
+    if (zstr_view_eq(idx->entries.data[i].name, old_name)) {
+      rename_entry(idx, i, new_name);
+      return true;
+    }
+  }
+  return false;
+}
+
+void index_drop_unseen(TryIndex *idx) {
+  size_t kept = 0;
+  for (size_t i = 0; i < idx->entries.length; i++) {
+    IndexEntry *e = &idx->entries.data[i];
+    if (e->seen) {
+      idx->entries.data[kept++] = *e;
+    } else {
+      idx->dirty = true;
+    }
+  }
+  idx->entries.length = kept;
+}
+
+bool index_is_fresh(time_t checked, time_t mtime) {
+  if (checked == 0 || checked < mtime)
+    return false;
+  return difftime(time(NULL), checked) < INDEX_TTL_SECONDS;
+}
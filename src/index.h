@@ -0,0 +1,108 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include "libs/zstr.h"
+#include "libs/zvec.h"
+#include "utils.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Per-root metadata cache stored as INDEX_FILE_NAME inside the tries
+// directory. It only holds values that are expensive (or risky) to
+// recompute: sizes, git status, and the mtime of tries on other mounts so
+// they can still be listed while that mount doesn't answer. Anything
+// missing or stale is recomputed and written back.
+
+typedef enum {
+  GIT_UNKNOWN = 0, // Never checked (or git failed)
+  GIT_NONE,        // Not a git repository
+  GIT_CLEAN,       // Repository without uncommitted changes
+  GIT_DIRTY        // Repository with uncommitted changes
+} GitState;
+
+typedef struct {
+  zstr_view name;        // Into the mapped index or TryIndex.names
+  uint64_t dev;          // Identity of the directory (st_dev, st_ino), so
+  uint64_t ino;          // cached values follow it across renames (0 = unknown)
+  time_t mtime;          // Directory mtime when the entry was last updated
+  uint64_t size_bytes;   // Disk usage of the whole tree
+  time_t size_checked;   // When size_bytes was computed (0 = never)
+  GitState git;
+  time_t git_checked;    // When git was computed (0 = never)
+  time_t stale_until;    // stat() timed out; don't retry before this
+  bool seen;             // Transient: matched by the current scan
+} IndexEntry;
+
+Z_VEC_GENERATE_IMPL(IndexEntry, IndexEntry)
+Z_VEC_GENERATE_IMPL(IndexEntry *, IndexEntryPtr)
+
+typedef struct {
+  zstr file;             // Full path of the index file
+  zstr journal;          // Full path of its journal
+  const char *map;       // The index file, mapped read-only (or NULL)
+  size_t map_len;
+  NameArena names;       // Names added since loading
+  size_t journal_size;   // Journal bytes replayed by index_load()
+  vec_IndexEntry entries;
+  time_t ignore_mtime;   // .tryignore that ignore_program was compiled from
+  uint64_t ignore_size;
+  zstr ignore_program;   // Compiled rules (see ignore.h)
+  zstr maint_cursor;     // Try `try maintain` resumes at (empty = start)
+  bool dirty;            // Needs index_save()
+} TryIndex;
+
+// Load the index for tries_path. A missing or unreadable index yields an
+// empty one, so callers never need to handle errors here.
+TryIndex index_load(const char *tries_path);
+
+// Write the index back if it changed (folding in the journal). Returns 0
+// on success.
+int index_save(TryIndex *idx);
+
+typedef enum {
+  JOURNAL_ADD = 1,   // Directory created
+  JOURNAL_DELETE,    // Directory removed
+  JOURNAL_RENAME     // Directory moved to new_name
+} JournalOp;
+
+// Record a change to the tries directory without loading or rewriting the
+// index; the next index_load() replays it. new_name is only used for
+// JOURNAL_RENAME. Returns 0 on success.
+int index_journal(const char *tries_path, JournalOp op, const char *name,
+                  const char *new_name);
+
+void index_free(TryIndex *idx);
+
+// Lookup by directory name (NULL if absent)
+IndexEntry *index_find(TryIndex *idx, const char *name);
+
+// Lookup by name, inserting an empty entry if absent
+IndexEntry *index_upsert(TryIndex *idx, const char *name);
+
+// Append an entry for a name the caller knows isn't indexed (no lookup)
+IndexEntry *index_add(TryIndex *idx, const char *name, uint64_t dev, uint64_t ino);
+
+// Entry for a directory seen as `name` with identity (dev, ino). Matched
+// by identity first, so a try renamed since the last scan keeps its cached
+// values, then by name; inserted if neither matches.
+IndexEntry *index_track(TryIndex *idx, const char *name, uint64_t dev, uint64_t ino);
+
+// The entries of idx in name order, for index_lookup(). Anything that adds,
+// renames or drops entries invalidates it.
+void index_sort_by_name(TryIndex *idx, vec_IndexEntryPtr *out);
+
+// Binary search of an index_sort_by_name() result (NULL if absent)
+IndexEntry *index_lookup(const vec_IndexEntryPtr *sorted, zstr_view name);
+
+// Move old_name's entry to new_name (e.g. before `mv` runs). Returns
+// false if old_name isn't indexed.
+bool index_rename(TryIndex *idx, const char *old_name, const char *new_name);
+
+// Remove entries not flagged `seen` (directories that no longer exist)
+void index_drop_unseen(TryIndex *idx);
+
+// True if a cached value computed at `checked` may still be used
+bool index_is_fresh(time_t checked, time_t mtime);
+
+#endif // INDEX_H
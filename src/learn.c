@@ -0,0 +1,280 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "learn.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * On-disk format (native endianness - like the index, a local cache that is
+ * simply started over if it doesn't match):
+ *
+ *   "TRYLRN" u16 version u32 slots u32 reserved
+ *   slots x { u64 key, u32 used, u32 reserved,
+ *             LEARN_TARGETS x { u64 id, f32 count, u32 seen } }
+ *
+ * key is the hash of a case-folded query prefix (0 = free slot), id the
+ * hash of a picked try's name with its length in the top byte, count the
+ * number of picks as of `seen` (Unix seconds); it halves every
+ * LEARN_HALF_LIFE_DAYS after that. used is the prefix's last pick, for
+ * eviction.
+ *
+ * A prefix lives within LEARN_PROBE slots of its home slot. Slots are
+ * replaced but never emptied, so a lookup can stop at the first free one.
+ * Writers take an exclusive flock(); readers don't lock and at worst see a
+ * count mid-update.
+ */
+
+#define LEARN_MAGIC "TRYLRN"
+#define LEARN_VERSION 1
+
+typedef struct {
+  char magic[6];
+  uint16_t version;
+  uint32_t slots;
+  uint32_t reserved;
+} LearnHeader;
+
+typedef struct {
+  uint64_t id;
+  float count;
+  uint32_t seen;
+} LearnTarget;
+
+typedef struct {
+  uint64_t key;
+  uint32_t used;
+  uint32_t reserved;
+  LearnTarget targets[LEARN_TARGETS];
+} LearnSlot;
+
+_Static_assert((LEARN_SLOTS & (LEARN_SLOTS - 1)) == 0, "LEARN_SLOTS must be a power of two");
+
+#define LEARN_TABLE_SIZE (sizeof(LearnHeader) + LEARN_SLOTS * sizeof(LearnSlot))
+
+// The table mapped by learn_open()
+static void *lookup_map = NULL;
+
+// ============================================================================
+// Hashing and decay
+// ============================================================================
+
+// FNV-1a, case-folded for query prefixes
+static uint64_t hash_bytes(const char *s, size_t len, bool fold) {
+  uint64_t h = 1469598103934665603ull;
+  for (size_t i = 0; i < len; i++) {
+    unsigned char c = (unsigned char)s[i];
+    if (fold && c >= 'A' && c <= 'Z')
+      c = (unsigned char)(c - 'A' + 'a');
+    h = (h ^ c) * 1099511628211ull;
+  }
+  return h;
+}
+
+static uint64_t prefix_key(const char *query, size_t len) {
+  uint64_t key = hash_bytes(query, len, true);
+  return key ? key : 1;
+}
+
+// The length in the top byte lets learn_bonus() skip hashing most names
+static inline uint64_t length_tag(size_t len) {
+  return (uint64_t)(len > 255 ? 255 : len) << 56;
+}
+
+static uint64_t entry_id(const char *name, size_t len) {
+  return (hash_bytes(name, len, false) & ~(0xffull << 56)) | length_tag(len);
+}
+
+static double decayed(const LearnTarget *t, uint32_t now) {
+  double age_days = now > t->seen ? (double)(now - t->seen) / 86400.0 : 0;
+  return t->count * exp2(-age_days / LEARN_HALF_LIFE_DAYS);
+}
+
+static bool table_valid(const void *map) {
+  const LearnHeader *h = map;
+  return memcmp(h->magic, LEARN_MAGIC, sizeof(h->magic)) == 0 &&
+         h->version == LEARN_VERSION && h->slots == LEARN_SLOTS;
+}
+
+static inline LearnSlot *table_slots(void *map) {
+  return (LearnSlot *)((char *)map + sizeof(LearnHeader));
+}
+
+// ============================================================================
+// Lookup
+// ============================================================================
+
+void learn_open(const char *tries_path) {
+  learn_close();
+  Z_CLEANUP(zstr_free) zstr file = join_path(tries_path, LEARN_FILE_NAME);
+  int fd = open(zstr_cstr(&file), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  struct stat sb;
+  // The size is fixed, so a mapping of the right size can't be cut short
+  if (fstat(fd, &sb) == 0 && (size_t)sb.st_size == LEARN_TABLE_SIZE) {
+    void *map = mmap(NULL, LEARN_TABLE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED && table_valid(map))
+      lookup_map = map;
+    else if (map != MAP_FAILED)
+      munmap(map, LEARN_TABLE_SIZE);
+  }
+  close(fd);
+}
+
+void learn_close(void) {
+  if (lookup_map)
+    munmap(lookup_map, LEARN_TABLE_SIZE);
+  lookup_map = NULL;
+}
+
+void learn_lookup(const char *query, LearnBoosts *out) {
+  out->count = 0;
+  size_t len = strlen(query);
+  if (!lookup_map || len == 0)
+    return;
+  if (len > LEARN_MAX_PREFIX)
+    len = LEARN_MAX_PREFIX;
+
+  const LearnSlot *slots = table_slots(lookup_map);
+  uint64_t key = prefix_key(query, len);
+  uint32_t now = (uint32_t)time(NULL);
+  for (size_t i = 0; i < LEARN_PROBE; i++) {
+    const LearnSlot *s = &slots[(key + i) & (LEARN_SLOTS - 1)];
+    if (s->key == 0)
+      return;
+    if (s->key != key)
+      continue;
+    for (size_t t = 0; t < LEARN_TARGETS; t++) {
+      if (s->targets[t].id == 0)
+        continue;
+      // Saturates: the first pick earns half the bonus, habits the rest
+      double count = decayed(&s->targets[t], now);
+      out->ids[out->count] = s->targets[t].id;
+      out->bonus[out->count] = (float)(LEARN_BONUS * count / (count + 1.0));
+      out->count++;
+    }
+    return;
+  }
+}
+
+float learn_bonus(const LearnBoosts *boosts, const TryEntry *entry) {
+  uint64_t tag = length_tag(entry->name.len);
+  uint64_t id = 0;
+  for (size_t i = 0; i < boosts->count; i++) {
+    if ((boosts->ids[i] & (0xffull << 56)) != tag)
+      continue;
+    if (id == 0)
+      id = entry_id(entry->name.data, entry->name.len);
+    if (id == boosts->ids[i])
+      return boosts->bonus[i];
+  }
+  return 0;
+}
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+// The slot for key: its own, a free one, or else the least recently used
+// in its probe window, cleared for it
+static LearnSlot *claim_slot(LearnSlot *slots, uint64_t key) {
+  LearnSlot *oldest = NULL;
+  for (size_t i = 0; i < LEARN_PROBE; i++) {
+    LearnSlot *s = &slots[(key + i) & (LEARN_SLOTS - 1)];
+    if (s->key == key)
+      return s;
+    if (s->key == 0) {
+      oldest = s;
+      break;
+    }
+    if (!oldest || s->used < oldest->used)
+      oldest = s;
+  }
+  memset(oldest, 0, sizeof(*oldest));
+  oldest->key = key;
+  return oldest;
+}
+
+// One more pick of id; a new target takes a free place or the weakest one's
+static void count_pick(LearnSlot *s, uint64_t id, uint32_t now) {
+  LearnTarget *weakest = NULL;
+  double weakest_count = 0;
+  for (size_t t = 0; t < LEARN_TARGETS; t++) {
+    LearnTarget *target = &s->targets[t];
+    if (target->id == id) {
+      target->count = (float)(decayed(target, now) + 1.0);
+      target->seen = now;
+      return;
+    }
+    double count = target->id ? decayed(target, now) : -1;
+    if (!weakest || count < weakest_count) {
+      weakest = target;
+      weakest_count = count;
+    }
+  }
+  *weakest = (LearnTarget){id, 1.0f, now};
+}
+
+void learn_record(const char *tries_path, const char *query, const char *name) {
+  size_t len = strlen(query);
+  if (len == 0)
+    return;
+  if (len > LEARN_MAX_PREFIX)
+    len = LEARN_MAX_PREFIX;
+
+  Z_CLEANUP(zstr_free) zstr file = join_path(tries_path, LEARN_FILE_NAME);
+  int fd = open(zstr_cstr(&file), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+  // Released by close()
+  if (flock(fd, LOCK_EX) != 0) {
+    close(fd);
+    return;
+  }
+
+  // A table of another size is started over. Readers only map a table of
+  // the right size, so the truncation can't pull pages from under them.
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 ||
+      ((size_t)sb.st_size != LEARN_TABLE_SIZE &&
+       (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)LEARN_TABLE_SIZE) != 0))) {
+    close(fd);
+    return;
+  }
+  void *map = mmap(NULL, LEARN_TABLE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return;
+  }
+  if (!table_valid(map)) {
+    memset(map, 0, LEARN_TABLE_SIZE);
+    LearnHeader *h = map;
+    memcpy(h->magic, LEARN_MAGIC, sizeof(h->magic));
+    h->version = LEARN_VERSION;
+    h->slots = LEARN_SLOTS;
+  }
+
+  LearnSlot *slots = table_slots(map);
+  uint64_t id = entry_id(name, strlen(name));
+  uint32_t now = (uint32_t)time(NULL);
+  for (size_t n = 1; n <= len; n++) {
+    LearnSlot *s = claim_slot(slots, prefix_key(query, n));
+    count_pick(s, id, now);
+    s->used = now;
+  }
+
+  munmap(map, LEARN_TABLE_SIZE);
+  close(fd);
+}
@@ -0,0 +1,39 @@
+#ifndef LEARN_H
+#define LEARN_H
+
+#include "config.h"
+#include "tui.h" // Need full definition of TryEntry
+#include <stddef.h>
+#include <stdint.h>
+
+// Selection learning: which try was picked in the selector after typing a
+// query, counted per query prefix and decayed over time, so a short query
+// that keeps leading to the same try ("rp" -> redis-connection-pool) ranks
+// it first. The counts live in LEARN_FILE_NAME in the tries root, a
+// fixed-size open-addressing table that is mapped rather than read; when a
+// prefix finds no free slot, the least recently picked one is replaced.
+
+// Bonuses for one query, from learn_lookup()
+typedef struct {
+  size_t count;
+  uint64_t ids[LEARN_TARGETS]; // Picked tries (hash of the name)
+  float bonus[LEARN_TARGETS];
+} LearnBoosts;
+
+// Map the table of tries_path for lookups; without one nothing is boosted.
+// Lookups may run on other threads until learn_close().
+void learn_open(const char *tries_path);
+void learn_close(void);
+
+// The bonuses query earns, looked up by its first LEARN_MAX_PREFIX
+// characters (case-folded). Empty for an empty query.
+void learn_lookup(const char *query, LearnBoosts *out);
+
+// What entry adds to its score under boosts (0 for all but a few)
+float learn_bonus(const LearnBoosts *boosts, const TryEntry *entry);
+
+// Count a pick of the try called name after typing query, under every
+// prefix of it, creating the table if needed
+void learn_record(const char *tries_path, const char *query, const char *name);
+
+#endif // LEARN_H
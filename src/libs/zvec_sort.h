@@ -0,0 +1,182 @@
+/*
+ * zvec_sort.h - type-specialized sorting and searching for zvec element types.
+ *
+ * Companion to zvec.h. vec_sort()/vec_bsearch() go through qsort/bsearch and
+ * call the comparator through a function pointer for every comparison; the
+ * generators here expand the ordering inline instead, once per element type
+ * and ordering.
+ *
+ *   Z_VEC_GENERATE_SORT(T, Order, LESS)
+ *
+ * LESS is an expression over `const T *a` and `const T *b` that is true when
+ * a sorts before b (a strict weak ordering). It generates, for plain arrays
+ * (pass v.data, v.length for a vector):
+ *
+ *   void   sort_Order(T *data, size_t n)          introsort, not stable
+ *   void   stable_sort_Order(T *data, size_t n)   merge sort, stable
+ *   void   partial_sort_Order(T *data, size_t n, size_t k)
+ *                                                 first min(k, n) in order
+ *   size_t lower_bound_Order(const T *data, size_t n, const T *key)
+ *                                                 first index not before key
+ */
+
+#ifndef ZVEC_SORT_H
+#define ZVEC_SORT_H
+
+#include "zvec.h" // Z_VEC_MALLOC / Z_VEC_FREE
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Below this size, insertion sort beats partitioning/merging
+#define Z_SORT_INSERTION_MAX 16
+
+#define Z_VEC_GENERATE_SORT(T, Order, LESS)                                                 \
+                                                                                            \
+static inline bool z_less_##Order(const T *a, const T *b) {                                 \
+    return (LESS);                                                                          \
+}                                                                                           \
+                                                                                            \
+static inline void z_swap_##Order(T *x, T *y) {                                             \
+    T tmp = *x;                                                                             \
+    *x = *y;                                                                                \
+    *y = tmp;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline void z_insertion_##Order(T *d, size_t n) {                                    \
+    for (size_t i = 1; i < n; i++) {                                                        \
+        T x = d[i];                                                                         \
+        size_t j = i;                                                                       \
+        while (j > 0 && z_less_##Order(&x, &d[j - 1])) {                                    \
+            d[j] = d[j - 1];                                                                \
+            j--;                                                                            \
+        }                                                                                   \
+        d[j] = x;                                                                           \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+/* Max-heap on LESS: the root is the element that sorts last */                             \
+static inline void z_sift_##Order(T *d, size_t root, size_t n) {                            \
+    for (;;) {                                                                              \
+        size_t c = 2 * root + 1;                                                            \
+        if (c >= n) return;                                                                 \
+        if (c + 1 < n && z_less_##Order(&d[c], &d[c + 1])) c++;                             \
+        if (!z_less_##Order(&d[root], &d[c])) return;                                       \
+        z_swap_##Order(&d[root], &d[c]);                                                    \
+        root = c;                                                                           \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+static inline void z_heapsort_##Order(T *d, size_t n) {                                     \
+    for (size_t i = n / 2; i-- > 0;) z_sift_##Order(d, i, n);                               \
+    for (size_t end = n; end-- > 1;) {                                                      \
+        z_swap_##Order(&d[0], &d[end]);                                                     \
+        z_sift_##Order(d, 0, end);                                                          \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+static inline void z_introsort_##Order(T *d, size_t n, int depth) {                         \
+    while (n > Z_SORT_INSERTION_MAX) {                                                      \
+        if (depth-- == 0) {                                                                 \
+            z_heapsort_##Order(d, n);                                                       \
+            return;                                                                         \
+        }                                                                                   \
+        /* Median of three; also makes d[0] and d[n-1] scan sentinels */                    \
+        size_t m = n / 2;                                                                   \
+        if (z_less_##Order(&d[m], &d[0])) z_swap_##Order(&d[m], &d[0]);                     \
+        if (z_less_##Order(&d[n - 1], &d[m])) {                                             \
+            z_swap_##Order(&d[n - 1], &d[m]);                                               \
+            if (z_less_##Order(&d[m], &d[0])) z_swap_##Order(&d[m], &d[0]);                 \
+        }                                                                                   \
+        T pivot = d[m];                                                                     \
+        /* Hoare partition: [0, j] sorts no later than pivot, [j+1, n) no earlier */        \
+        size_t i = 0, j = n - 1;                                                            \
+        for (;;) {                                                                          \
+            while (z_less_##Order(&d[i], &pivot)) i++;                                      \
+            while (z_less_##Order(&pivot, &d[j])) j--;                                      \
+            if (i >= j) break;                                                              \
+            z_swap_##Order(&d[i], &d[j]);                                                   \
+            i++;                                                                            \
+            j--;                                                                            \
+        }                                                                                   \
+        size_t left = j + 1;                                                                \
+        /* Recurse into the smaller side, loop on the larger */                             \
+        if (left < n - left) {                                                              \
+            z_introsort_##Order(d, left, depth);                                            \
+            d += left;                                                                      \
+            n -= left;                                                                      \
+        } else {                                                                            \
+            z_introsort_##Order(d + left, n - left, depth);                                 \
+            n = left;                                                                       \
+        }                                                                                   \
+    }                                                                                       \
+    z_insertion_##Order(d, n);                                                              \
+}                                                                                           \
+                                                                                            \
+static inline void sort_##Order(T *data, size_t n) {                                        \
+    int depth = 0;                                                                          \
+    for (size_t s = n; s > 1; s >>= 1) depth += 2;                                          \
+    z_introsort_##Order(data, n, depth);                                                    \
+}                                                                                           \
+                                                                                            \
+static inline void z_merge_##Order(T *d, size_t n, T *buf) {                                \
+    if (n <= Z_SORT_INSERTION_MAX) {                                                        \
+        z_insertion_##Order(d, n);                                                          \
+        return;                                                                             \
+    }                                                                                       \
+    size_t mid = n / 2;                                                                     \
+    z_merge_##Order(d, mid, buf);                                                           \
+    z_merge_##Order(d + mid, n - mid, buf);                                                 \
+    if (!z_less_##Order(&d[mid], &d[mid - 1])) return; /* Already in order */              \
+    memcpy(buf, d, mid * sizeof(T));                                                        \
+    size_t i = 0, j = mid, k = 0;                                                           \
+    while (i < mid && j < n) {                                                              \
+        /* Take from the left on ties to stay stable */                                     \
+        if (z_less_##Order(&d[j], &buf[i])) d[k++] = d[j++];                                \
+        else d[k++] = buf[i++];                                                             \
+    }                                                                                       \
+    while (i < mid) d[k++] = buf[i++];                                                      \
+}                                                                                           \
+                                                                                            \
+static inline void stable_sort_##Order(T *data, size_t n) {                                 \
+    if (n <= Z_SORT_INSERTION_MAX) {                                                        \
+        z_insertion_##Order(data, n);                                                       \
+        return;                                                                             \
+    }                                                                                       \
+    T *buf = (T *)Z_VEC_MALLOC((n / 2) * sizeof(T));                                        \
+    if (!buf) {                                                                             \
+        z_insertion_##Order(data, n); /* Slow but still stable */                           \
+        return;                                                                             \
+    }                                                                                       \
+    z_merge_##Order(data, n, buf);                                                          \
+    Z_VEC_FREE(buf);                                                                        \
+}                                                                                           \
+                                                                                            \
+static inline void partial_sort_##Order(T *data, size_t n, size_t k) {                      \
+    if (k > n) k = n;                                                                       \
+    if (k == 0) return;                                                                     \
+    /* Keep the k earliest in a max-heap, then sort the heap */                             \
+    for (size_t i = k / 2; i-- > 0;) z_sift_##Order(data, i, k);                            \
+    for (size_t i = k; i < n; i++) {                                                        \
+        if (z_less_##Order(&data[i], &data[0])) {                                           \
+            z_swap_##Order(&data[i], &data[0]);                                             \
+            z_sift_##Order(data, 0, k);                                                     \
+        }                                                                                   \
+    }                                                                                       \
+    for (size_t end = k; end-- > 1;) {                                                      \
+        z_swap_##Order(&data[0], &data[end]);                                               \
+        z_sift_##Order(data, 0, end);                                                       \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+static inline size_t lower_bound_##Order(const T *data, size_t n, const T *key) {           \
+    size_t l = 0, r = n;                                                                    \
+    while (l < r) {                                                                         \
+        size_t m = l + (r - l) / 2;                                                         \
+        if (z_less_##Order(&data[m], key)) l = m + 1;                                       \
+        else r = m;                                                                         \
+    }                                                                                       \
+    return l;                                                                               \
+}
+
+#endif // ZVEC_SORT_H
@@ -5,8 +5,13 @@
 #define _GNU_SOURCE
 #endif
 
+#include "alloc_stats.h"
 #include "commands.h"
 #include "config.h"
+#include "prewarm.h"
+#include "speculate.h"
+#include "metrics.h"
+#include "stats.h"
 #include "utils.h"
 #include "tui.h"
 #include <stdio.h>
@@ -50,6 +55,18 @@ static void print_help(void) {
   tui_zstr_printf(&help, TUI_DIM, "Interactive selector, or clone if URL");
   zstr_cat(&help, "\n");
 
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try --first");
+  zstr_cat(&help, " <query>  ");
+  tui_zstr_printf(&help, TUI_DIM, "Jump to the best match without the selector");
+  zstr_cat(&help, "\n");
+
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try -");
+  zstr_cat(&help, "                ");
+  tui_zstr_printf(&help, TUI_DIM, "Jump to the most recently used try");
+  zstr_cat(&help, "\n");
+
   zstr_cat(&help, "  ");
   tui_zstr_printf(&help, TUI_BOLD, "try clone");
   zstr_cat(&help, " <url>      ");
@@ -62,6 +79,48 @@ static void print_help(void) {
   tui_zstr_printf(&help, TUI_DIM, "Create worktree from current git repo");
   zstr_cat(&help, "\n");
 
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try --tmp");
+  zstr_cat(&help, " <name>     ");
+  tui_zstr_printf(&help, TUI_DIM, "Scratch try on tmpfs (RAM)");
+  zstr_cat(&help, "\n");
+
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try persist");
+  zstr_cat(&help, " [name]   ");
+  tui_zstr_printf(&help, TUI_DIM, "Sync scratch tries back to disk");
+  zstr_cat(&help, "\n");
+
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try prune");
+  zstr_cat(&help, " [rules]    ");
+  tui_zstr_printf(&help, TUI_DIM, "Delete old/large tries (--older-than, --larger-than, --git-clean)");
+  zstr_cat(&help, "\n");
+
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try list");
+  zstr_cat(&help, " [query]     ");
+  tui_zstr_printf(&help, TUI_DIM, "Print ranked paths (--queries-file for batches)");
+  zstr_cat(&help, "\n");
+
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try perf-report");
+  zstr_cat(&help, "      ");
+  tui_zstr_printf(&help, TUI_DIM, "Latency percentiles from TRY_METRICS_LOG");
+  zstr_cat(&help, "\n");
+
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try maintain");
+  zstr_cat(&help, "         ");
+  tui_zstr_printf(&help, TUI_DIM, "Refresh cached sizes/git status within a budget (--cpu-ms, --io)");
+  zstr_cat(&help, "\n");
+
+  zstr_cat(&help, "  ");
+  tui_zstr_printf(&help, TUI_BOLD, "try prewarm");
+  zstr_cat(&help, " <path>   ");
+  tui_zstr_printf(&help, TUI_DIM, "Read a try ahead into the page cache (--prewarm does it on cd)");
+  zstr_cat(&help, "\n");
+
   zstr_cat(&help, "  ");
   tui_zstr_printf(&help, TUI_BOLD, "try exec");
   zstr_cat(&help, " [query]     ");
@@ -108,31 +167,22 @@ static void print_help(void) {
   tui_zstr_printf(&help, ANSI_BRIGHT_BLUE, "# YYYY-MM-DD-feature");
   zstr_cat(&help, "\n");
 
-  fprintf(stderr, "%s", zstr_cstr(&help));
-}
-
-// Parse a --flag=value or --flag value option, returns value or NULL
-// Sets *skip to 1 if value was in next arg (so caller can skip it)
-static const char *parse_option_value(const char *arg, const char *next_arg,
-                                       const char *flag, int *skip) {
-  size_t flag_len = strlen(flag);
-  *skip = 0;
-
-  // Check --flag=value form
-  if (strncmp(arg, flag, flag_len) == 0 && arg[flag_len] == '=') {
-    return arg + flag_len + 1;
-  }
+  zstr_cat(&help, "  try redis --auto-accept 1.5                      ");
+  tui_zstr_printf(&help, ANSI_BRIGHT_BLUE, "# skip the selector on a clear winner");
+  zstr_cat(&help, "\n");
 
-  // Check --flag value form
-  if (strcmp(arg, flag) == 0 && next_arg != NULL) {
-    *skip = 1;
-    return next_arg;
-  }
+  zstr_cat(&help, "  try prune --older-than 90d --git-clean           ");
+  tui_zstr_printf(&help, ANSI_BRIGHT_BLUE, "# confirm, then delete");
+  zstr_cat(&help, "\n");
 
-  return NULL;
+  fprintf(stderr, "%s", zstr_cstr(&help));
 }
 
 int main(int argc, char **argv) {
+#ifdef TRY_ALLOC_STATS
+  atexit(alloc_stats_report);
+#endif
+  metrics_init();
   Z_CLEANUP(zstr_free) zstr tries_path = zstr_init();
   Z_CLEANUP(vec_free_char_ptr) vec_char_ptr cmd_args = vec_init_capacity_char_ptr(argc);
 
@@ -165,6 +215,18 @@ int main(int argc, char **argv) {
       tui_no_colors = true;
       continue;
     }
+    if (strcmp(arg, "--speculate") == 0) {
+      try_speculate_enabled = true;
+      continue;
+    }
+    if (strcmp(arg, "--prewarm") == 0) {
+      try_prewarm_enabled = true;
+      continue;
+    }
+    if (strcmp(arg, "--stats") == 0) {
+      try_stats_enabled = true;
+      continue;
+    }
     if (strcmp(arg, "--and-exit") == 0) {
       test.render_once = true;
       continue;
@@ -199,8 +261,10 @@ int main(int argc, char **argv) {
 
   const char *path_cstr = zstr_cstr(&tries_path);
 
-  // Ensure tries directory exists
-  if (!dir_exists(path_cstr)) {
+  // Ensure tries directory exists. Not for prewarm: it only reads the path
+  // it's given, and as a detached helper it runs without --path.
+  bool is_prewarm = cmd_args.length > 0 && strcmp(cmd_args.data[0], "prewarm") == 0;
+  if (!is_prewarm && !dir_exists(path_cstr)) {
     if (mkdir_p(path_cstr) != 0) {
       fprintf(stderr, "Error: Could not create tries directory: %s\n", path_cstr);
       return 1;
@@ -214,11 +278,23 @@ int main(int argc, char **argv) {
   }
 
   const char *command = *vec_at_char_ptr(&cmd_args, 0);
+  // The shell wrapper runs everything through exec; log what it ran
+  try_metrics.command = command;
+  if (strcmp(command, "exec") == 0)
+    try_metrics.command = cmd_args.length > 1 ? cmd_args.data[1] : "cd";
 
   // Route commands
   if (strcmp(command, "init") == 0) {
     cmd_init((int)cmd_args.length - 1, cmd_args.data + 1, path_cstr);
     return 0;
+  } else if (strcmp(command, "list") == 0) {
+    return cmd_list((int)cmd_args.length - 1, cmd_args.data + 1, path_cstr);
+  } else if (strcmp(command, "perf-report") == 0) {
+    return cmd_perf_report((int)cmd_args.length - 1, cmd_args.data + 1);
+  } else if (strcmp(command, "maintain") == 0) {
+    return cmd_maintain((int)cmd_args.length - 1, cmd_args.data + 1, path_cstr);
+  } else if (strcmp(command, "prewarm") == 0) {
+    return cmd_prewarm((int)cmd_args.length - 1, cmd_args.data + 1);
   } else if (strcmp(command, "exec") == 0) {
     // Exec mode - route subcommand and print script
     exec_mode = true;
@@ -252,6 +328,39 @@ int main(int argc, char **argv) {
       return 1;
     }
     return run_script(zstr_cstr(&script), exec_mode);
+  } else if (strcmp(command, "--first") == 0 || strcmp(command, "-") == 0) {
+    // Direct mode jump (no TUI)
+    bool recent = strcmp(command, "-") == 0;
+    Z_CLEANUP(zstr_free) zstr script = cmd_first(
+        recent ? 0 : (int)cmd_args.length - 1, cmd_args.data + 1, path_cstr);
+    if (zstr_is_empty(&script)) {
+      return 1;
+    }
+    return run_script(zstr_cstr(&script), exec_mode);
+  } else if (strcmp(command, "--tmp") == 0) {
+    // Direct mode scratch try
+    Z_CLEANUP(zstr_free) zstr script = cmd_tmp(
+        (int)cmd_args.length - 1, cmd_args.data + 1, path_cstr);
+    if (zstr_is_empty(&script)) {
+      return 1;
+    }
+    return run_script(zstr_cstr(&script), exec_mode);
+  } else if (strcmp(command, "persist") == 0) {
+    // Direct mode persist
+    Z_CLEANUP(zstr_free) zstr script = cmd_persist(
+        (int)cmd_args.length - 1, cmd_args.data + 1, path_cstr);
+    if (zstr_is_empty(&script)) {
+      return 1;
+    }
+    return run_script(zstr_cstr(&script), exec_mode);
+  } else if (strcmp(command, "prune") == 0) {
+    // Direct mode prune
+    Z_CLEANUP(zstr_free) zstr script = cmd_prune(
+        (int)cmd_args.length - 1, cmd_args.data + 1, path_cstr, &test);
+    if (zstr_is_empty(&script)) {
+      return 1;
+    }
+    return run_script(zstr_cstr(&script), exec_mode);
   } else if (strncmp(command, "https://", 8) == 0 ||
              strncmp(command, "http://", 7) == 0 ||
              strncmp(command, "git@", 4) == 0) {
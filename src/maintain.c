@@ -0,0 +1,318 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "maintain.h"
+#include "config.h"
+#include "ignore.h"
+#include "index.h"
+#include "libs/zvec_sort.h"
+#include "meta.h"
+#include "scan.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <pthread/qos.h>
+#endif
+
+// Named so `const T *` in the generators is a pointer to a const pointer
+typedef TryEntry *TryEntryRef;
+
+Z_VEC_GENERATE_SORT(TryEntryRef, TryByName, view_cmp((*a)->name, (*b)->name) < 0)
+
+// ============================================================================
+// Priority and budgets
+// ============================================================================
+
+void maintain_lower_priority(bool whole_process) {
+#if defined(__linux__)
+  // Nice values and I/O priorities belong to the calling thread on Linux,
+  // and threads and children created afterwards inherit them
+  (void)whole_process;
+  enum { IOPRIO_WHO_PROCESS = 1, IOPRIO_CLASS_IDLE = 3, IOPRIO_CLASS_SHIFT = 13 };
+  setpriority(PRIO_PROCESS, 0, MAINTAIN_NICE);
+#ifdef SYS_ioprio_set
+  syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+#endif
+#elif defined(__APPLE__)
+  if (whole_process) {
+    setpriority(PRIO_PROCESS, 0, MAINTAIN_NICE);
+    setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE);
+  } else {
+    // Background QoS throttles both CPU and disk for this thread
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+  }
+#else
+  if (whole_process)
+    setpriority(PRIO_PROCESS, 0, MAINTAIN_NICE);
+#endif
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+typedef struct {
+  double cpu_ms;
+  uint64_t io_bytes;
+} Usage;
+
+// Resources used by this thread (where the platform can tell threads apart)
+// and by the git processes it waited for
+static Usage usage_now(void) {
+  struct rusage self = {0}, kids = {0};
+#ifdef RUSAGE_THREAD
+  getrusage(RUSAGE_THREAD, &self);
+#else
+  getrusage(RUSAGE_SELF, &self);
+#endif
+  getrusage(RUSAGE_CHILDREN, &kids);
+
+  Usage u;
+  u.cpu_ms = 0;
+  const struct rusage *both[] = {&self, &kids};
+  for (int i = 0; i < 2; i++) {
+    u.cpu_ms += (double)both[i]->ru_utime.tv_sec * 1000.0 + both[i]->ru_utime.tv_usec / 1000.0;
+    u.cpu_ms += (double)both[i]->ru_stime.tv_sec * 1000.0 + both[i]->ru_stime.tv_usec / 1000.0;
+  }
+  // Block counts are in 512-byte units; reads served from the page cache
+  // don't show up, which is what an I/O budget should measure
+  u.io_bytes = (uint64_t)(self.ru_inblock + self.ru_oublock + kids.ru_inblock + kids.ru_oublock) * 512;
+  return u;
+}
+
+static Usage usage_since(Usage start) {
+  Usage now = usage_now();
+  now.cpu_ms -= start.cpu_ms;
+  now.io_bytes = now.io_bytes > start.io_bytes ? now.io_bytes - start.io_bytes : 0;
+  return now;
+}
+
+static bool over_budget(const MaintainBudget *budget, Usage used) {
+  return (budget->cpu_ms > 0 && used.cpu_ms >= budget->cpu_ms) ||
+         (budget->io_bytes > 0 && used.io_bytes >= budget->io_bytes);
+}
+
+// ============================================================================
+// Maintenance pass
+// ============================================================================
+
+// Index writes from the idle worker stop once the selector has exited, so
+// they can't race whatever the selected action does to the index. The
+// worker signals idle_done when its last save is behind it.
+static pthread_mutex_t save_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t save_cond = PTHREAD_COND_INITIALIZER;
+static bool save_abandoned = false;
+static bool idle_done = false;
+
+static void checkpoint(TryIndex *idx) {
+  pthread_mutex_lock(&save_lock);
+  if (!save_abandoned)
+    index_save(idx);
+  pthread_mutex_unlock(&save_lock);
+}
+
+static void set_cursor(TryIndex *idx, zstr_view name) {
+  if (zstr_len(&idx->maint_cursor) == name.len &&
+      memcmp(zstr_cstr(&idx->maint_cursor), name.data, name.len) == 0)
+    return;
+  zstr_free(&idx->maint_cursor);
+  idx->maint_cursor = zstr_from_len(name.data, name.len);
+  idx->dirty = true;
+}
+
+MaintainReport maintain_run(const char *tries_path, const vec_TryEntry *entries,
+                            const MaintainBudget *budget, atomic_bool *cancel) {
+  MaintainReport report = {0};
+  Usage start = usage_now();
+
+  TryIndex idx = index_load(tries_path);
+  TryIgnore ignore = ignore_load(tries_path, &idx);
+
+  // Tries and index entries in name order: the cursor is a name, so the
+  // next run resumes in the right place even if tries came and went
+  vec_TryEntryPtr order = {0};
+  for (size_t i = 0; i < entries->length; i++) {
+    if (!entries->data[i].pending)
+      vec_push_TryEntryPtr(&order, (TryEntry *)&entries->data[i]);
+  }
+  sort_TryByName(order.data, order.length);
+
+  vec_IndexEntryPtr cached_order = {0};
+  scan_reconcile_index(&idx, entries, &cached_order);
+
+  TryEntry cursor_key = {.name = zstr_as_view(&idx.maint_cursor)};
+  TryEntry *cursor_ptr = &cursor_key;
+  size_t n = order.length;
+  size_t first = lower_bound_TryByName(order.data, n, &cursor_ptr);
+  if (first == n)
+    first = 0;
+
+  size_t done = 0;
+  double last_checkpoint = now_ms();
+  for (; done < n; done++) {
+    if (cancel && atomic_load_explicit(cancel, memory_order_relaxed))
+      break;
+    if (over_budget(budget, usage_since(start)))
+      break;
+
+    TryEntry *entry = order.data[(first + done) % n];
+    IndexEntry *cached = index_lookup(&cached_order, entry->name);
+    report.checked++;
+
+    bool need_size = !index_is_fresh(cached->size_checked, entry->mtime);
+    bool need_git = !index_is_fresh(cached->git_checked, entry->mtime);
+    if (!need_size && !need_git)
+      continue;
+
+    Z_CLEANUP(zstr_free) zstr path = try_entry_path(tries_path, entry);
+    time_t now = time(NULL);
+    if (need_size) {
+      cached->size_bytes = meta_disk_usage(zstr_cstr(&path), &ignore, entry->name.data);
+      cached->size_checked = now;
+      report.sizes++;
+    }
+    if (need_git) {
+      cached->git = meta_git_state(zstr_cstr(&path));
+      cached->git_checked = now;
+      report.git++;
+    }
+    cached->mtime = entry->mtime;
+    idx.dirty = true;
+
+    // The whole index is rewritten each time, so checkpoints go by time
+    if (now_ms() - last_checkpoint >= MAINTAIN_CHECKPOINT_MS && done + 1 < n) {
+      set_cursor(&idx, order.data[(first + done + 1) % n]->name);
+      checkpoint(&idx);
+      last_checkpoint = now_ms();
+    }
+  }
+
+  if (done == n) {
+    report.finished = true;
+    set_cursor(&idx, zstr_view_from(""));
+  } else {
+    set_cursor(&idx, order.data[(first + done) % n]->name);
+  }
+  checkpoint(&idx);
+
+  Usage used = usage_since(start);
+  report.cpu_ms = used.cpu_ms;
+  report.io_bytes = used.io_bytes;
+
+  vec_free_IndexEntryPtr(&cached_order);
+  vec_free_TryEntryPtr(&order);
+  ignore_free(&ignore);
+  index_free(&idx);
+  return report;
+}
+
+// ============================================================================
+// Idle maintenance in the selector
+// ============================================================================
+
+typedef struct {
+  zstr tries_path;
+  vec_TryEntry entries; // Own copy; the selector's list changes under it
+  NameArena names;
+} IdleJob;
+
+static atomic_bool idle_cancel;
+static bool idle_running = false;
+
+static void *idle_main(void *arg) {
+  IdleJob *job = arg;
+  maintain_lower_priority(false);
+
+  // A quick pick never pays for any of this
+  for (int waited = 0; waited < MAINTAIN_IDLE_DELAY_MS; waited += 20) {
+    if (atomic_load_explicit(&idle_cancel, memory_order_relaxed))
+      break;
+    nanosleep(&(struct timespec){0, 20 * 1000000L}, NULL);
+  }
+  if (!atomic_load_explicit(&idle_cancel, memory_order_relaxed)) {
+    MaintainBudget budget = {MAINTAIN_IDLE_CPU_MS, MAINTAIN_IDLE_IO_BYTES};
+    maintain_run(zstr_cstr(&job->tries_path), &job->entries, &budget, &idle_cancel);
+  }
+
+  pthread_mutex_lock(&save_lock);
+  idle_done = true;
+  pthread_cond_signal(&save_cond);
+  pthread_mutex_unlock(&save_lock);
+
+  free_try_entries(&job->entries, &job->names);
+  zstr_free(&job->tries_path);
+  Z_FREE(job);
+  return NULL;
+}
+
+void maintain_idle_start(const char *tries_path, const vec_TryEntry *entries) {
+  const char *env = getenv("TRY_MAINTAIN");
+  if ((env && strcmp(env, "0") == 0) || idle_running || entries->length == 0)
+    return;
+
+  IdleJob *job = Z_CALLOC(1, sizeof(*job));
+  if (!job)
+    return;
+  job->tries_path = zstr_from(tries_path);
+  const TryEntry *src;
+  vec_foreach(entries, src) {
+    TryEntry copy = *src;
+    copy.name = names_add(&job->names, src->name.data, src->name.len);
+    copy.rendered = zstr_init();
+    vec_push_TryEntry(&job->entries, copy);
+  }
+
+  atomic_store(&idle_cancel, false);
+
+  // Signals stay with the main thread (SIGWINCH interrupts read_key())
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, idle_main, job) == 0) {
+    // Never joined: a du or git on a slow tree mustn't hold up the exit
+    pthread_detach(thread);
+    idle_running = true;
+  } else {
+    free_try_entries(&job->entries, &job->names);
+    zstr_free(&job->tries_path);
+    Z_FREE(job);
+  }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+void maintain_idle_stop(void) {
+  if (!idle_running)
+    return;
+  atomic_store(&idle_cancel, true);
+
+  // Give the worker a moment to save what it has done. One stuck in a du
+  // or git on a slow tree is left behind and kept off the index.
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += MAINTAIN_STOP_WAIT_MS * 1000000L;
+  deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+  deadline.tv_nsec %= 1000000000L;
+  pthread_mutex_lock(&save_lock);
+  while (!idle_done) {
+    if (pthread_cond_timedwait(&save_cond, &save_lock, &deadline) != 0)
+      break;
+  }
+  save_abandoned = true;
+  pthread_mutex_unlock(&save_lock);
+  idle_running = false;
+}
@@ -0,0 +1,47 @@
+#ifndef MAINTAIN_H
+#define MAINTAIN_H
+
+#include "tui.h"
+#include "utils.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Background maintenance of the index: sizes and git status are computed
+// ahead of time so `try prune` finds them cached. Work is bounded by CPU
+// and I/O budgets and checkpointed in the index (maint_cursor), so each
+// run picks up where the previous one stopped. It runs from cron as
+// `try maintain` and, unless TRY_MAINTAIN=0, on a thread while the
+// selector waits for input.
+
+typedef struct {
+  double cpu_ms;     // CPU time, including git children (0 = unlimited)
+  uint64_t io_bytes; // Bytes read from or written to disk (0 = unlimited)
+} MaintainBudget;
+
+typedef struct {
+  size_t checked;    // Tries looked at
+  size_t sizes;      // Disk usages computed
+  size_t git;        // Git states computed
+  bool finished;     // Went all the way round; the cursor was reset
+  double cpu_ms;
+  uint64_t io_bytes;
+} MaintainReport;
+
+// Run the calling thread (or, if whole_process, the process) at the lowest
+// CPU priority and in the idle I/O class where the platform has one.
+// Children inherit it.
+void maintain_lower_priority(bool whole_process);
+
+// Bring the index entries of the tries in entries (a scan of tries_path) up
+// to date, starting at the cursor, until the round is done, a budget runs
+// out or *cancel (may be NULL) is set.
+MaintainReport maintain_run(const char *tries_path, const vec_TryEntry *entries,
+                            const MaintainBudget *budget, atomic_bool *cancel);
+
+// Idle maintenance for the selector. start takes its own copy of the entry
+// list; stop returns at once, and the index is not written after it.
+void maintain_idle_start(const char *tries_path, const vec_TryEntry *entries);
+void maintain_idle_stop(void);
+
+#endif // MAINTAIN_H
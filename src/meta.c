@@ -0,0 +1,134 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "meta.h"
+#include "utils.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// Sum st_blocks below an open directory. Takes ownership of fd. With
+// ignore rules, rel holds the directory's path relative to the tries root
+// (rel_len bytes) and ignored children are skipped before fstatat().
+static uint64_t disk_usage_fd(int fd, const TryIgnore *ig, char *rel, size_t rel_len) {
+  DIR *d = fdopendir(fd);
+  if (!d) {
+    close(fd);
+    return 0;
+  }
+
+  uint64_t total = 0;
+  struct dirent *de;
+  while ((de = readdir(d)) != NULL) {
+    if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+      continue;
+
+    size_t child_len = rel_len;
+    if (ig) {
+      size_t name_len = strlen(de->d_name);
+      if (rel_len + 1 + name_len >= PATH_MAX)
+        continue;
+      rel[rel_len] = '/';
+      memcpy(rel + rel_len + 1, de->d_name, name_len + 1);
+      child_len = rel_len + 1 + name_len;
+      // Without d_type a directory-only rule can't be decided before
+      // stat(); assume a directory so `node_modules/` still prunes
+      if (ignore_match(ig, rel, de->d_type == DT_DIR || de->d_type == DT_UNKNOWN))
+        continue;
+    }
+
+    struct stat sb;
+    if (fstatat(dirfd(d), de->d_name, &sb, AT_SYMLINK_NOFOLLOW) != 0)
+      continue;
+    total += (uint64_t)sb.st_blocks * 512;
+
+    if (S_ISDIR(sb.st_mode)) {
+      int child = openat(dirfd(d), de->d_name,
+                         O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (child >= 0)
+        total += disk_usage_fd(child, ig, rel, child_len);
+    }
+  }
+  closedir(d);
+  return total;
+}
+
+uint64_t meta_disk_usage(const char *path, const TryIgnore *ig, const char *name) {
+  struct stat sb;
+  if (lstat(path, &sb) != 0)
+    return 0;
+  uint64_t total = (uint64_t)sb.st_blocks * 512;
+
+  char rel[PATH_MAX];
+  size_t rel_len = strlen(name);
+  if (ig && ignore_empty(ig))
+    ig = NULL;
+  if (rel_len >= sizeof(rel))
+    ig = NULL;
+  else
+    memcpy(rel, name, rel_len + 1);
+
+  int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0)
+    total += disk_usage_fd(fd, ig, rel, rel_len);
+  return total;
+}
+
+GitState meta_git_state(const char *path) {
+  Z_CLEANUP(zstr_free) zstr git_path = join_path(path, ".git");
+  if (access(zstr_cstr(&git_path), F_OK) != 0)
+    return GIT_NONE;
+
+  // Spawn git directly (no shell) so paths need no quoting
+  int pipefd[2];
+  if (pipe(pipefd) != 0)
+    return GIT_UNKNOWN;
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addclose(&actions, pipefd[0]);
+  posix_spawn_file_actions_addclose(&actions, pipefd[1]);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                   O_WRONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                   O_RDONLY, 0);
+
+  char *argv[] = {"git", "-C", (char *)path, "status", "--porcelain", NULL};
+  pid_t pid;
+  int rc = posix_spawnp(&pid, "git", &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipefd[1]);
+
+  if (rc != 0) {
+    close(pipefd[0]);
+    return GIT_UNKNOWN;
+  }
+
+  // Any output at all means uncommitted changes; drain the rest
+  bool has_output = false;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(pipefd[0], buf, sizeof(buf))) > 0) {
+    has_output = true;
+  }
+  close(pipefd[0]);
+
+  int status;
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    return GIT_UNKNOWN;
+  }
+  return has_output ? GIT_DIRTY : GIT_CLEAN;
+}
@@ -0,0 +1,19 @@
+#ifndef META_H
+#define META_H
+
+#include "ignore.h"
+#include "index.h"
+#include <stdint.h>
+
+// Expensive per-try metadata. These walk the filesystem or spawn git, so
+// results are normally cached in the index (see index.h).
+
+// Total disk usage (allocated blocks) of the tree at path, without
+// following symlinks. Subtrees matched by ig (may be NULL) are left out;
+// name is the try's directory name, the root of the relative paths.
+uint64_t meta_disk_usage(const char *path, const TryIgnore *ig, const char *name);
+
+// Worktree state of the try at path
+GitState meta_git_state(const char *path);
+
+#endif // META_H
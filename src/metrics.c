@@ -0,0 +1,275 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "metrics.h"
+#include "libs/zstr.h"
+#include "libs/zvec.h"
+#include "libs/zvec_sort.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+TryMetrics try_metrics = {0};
+bool try_metrics_enabled = false;
+
+double metrics_now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+void metrics_add_filter(double ms) {
+  if (try_metrics.filter_count < METRICS_MAX_SAMPLES)
+    try_metrics.filter_ms[try_metrics.filter_count++] = (float)ms;
+}
+
+void metrics_add_render(double ms) {
+  if (try_metrics.render_count < METRICS_MAX_SAMPLES)
+    try_metrics.render_ms[try_metrics.render_count++] = (float)ms;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+static void cat_samples(zstr *line, const char *key, const float *v, uint32_t n) {
+  zstr_fmt(line, ",\"%s\":[", key);
+  for (uint32_t i = 0; i < n; i++)
+    zstr_fmt(line, i ? ",%.3f" : "%.3f", v[i]);
+  zstr_cat(line, "]");
+}
+
+// Names are ours or argv words; keep the line valid JSON regardless
+static void cat_string(zstr *line, const char *key, const char *value) {
+  zstr_fmt(line, ",\"%s\":\"", key);
+  for (const char *p = value ? value : ""; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c == '"' || c == '\\')
+      zstr_push(line, '\\');
+    if (c >= 0x20)
+      zstr_push(line, (char)c);
+  }
+  zstr_cat(line, "\"");
+}
+
+static void metrics_write(void) {
+  // Commands that opt out (the prewarm helper) clear the flag after init
+  const char *path = getenv("TRY_METRICS_LOG");
+  if (!try_metrics_enabled || !path || !*path)
+    return;
+
+  TryMetrics *m = &try_metrics;
+  Z_CLEANUP(zstr_free) zstr line = zstr_init();
+  zstr_fmt(&line, "{\"ts\":%lld", (long long)time(NULL));
+  cat_string(&line, "version", TRY_VERSION);
+  cat_string(&line, "command", m->command ? m->command : "help");
+  zstr_fmt(&line, ",\"entries\":%zu,\"startup_ms\":%.3f,\"scan_ms\":%.3f,\"keys\":%u",
+           m->entries, m->startup_ms, m->scan_ms, m->keys);
+  cat_samples(&line, "filter_ms", m->filter_ms, m->filter_count);
+  cat_samples(&line, "render_ms", m->render_ms, m->render_count);
+  if (m->action)
+    cat_string(&line, "action", m->action);
+  zstr_fmt(&line, ",\"total_ms\":%.3f}\n", metrics_now_ms() - m->start_ms);
+
+  // One O_APPEND write per line, so concurrent invocations don't interleave
+  int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+  ssize_t n = write(fd, zstr_cstr(&line), zstr_len(&line));
+  (void)n; // Best effort: a lost line must not fail the command
+  close(fd);
+}
+
+void metrics_init(void) {
+  const char *path = getenv("TRY_METRICS_LOG");
+  if (!path || !*path)
+    return;
+  try_metrics_enabled = true;
+  try_metrics.start_ms = metrics_now_ms();
+  atexit(metrics_write);
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+Z_VEC_GENERATE_IMPL(double, double)
+Z_VEC_GENERATE_SORT(double, double, *a < *b)
+
+// Number after "key": (0 if missing)
+static double json_number(const char *line, const char *key) {
+  char pattern[32];
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  const char *p = strstr(line, pattern);
+  return p ? strtod(p + strlen(pattern), NULL) : 0.0;
+}
+
+// Numbers in "key":[...] appended to out
+static void json_numbers(const char *line, const char *key, vec_double *out) {
+  char pattern[32];
+  snprintf(pattern, sizeof(pattern), "\"%s\":[", key);
+  const char *p = strstr(line, pattern);
+  if (!p)
+    return;
+  p += strlen(pattern);
+  while (*p && *p != ']') {
+    char *end;
+    double v = strtod(p, &end);
+    if (end == p)
+      break;
+    vec_push_double(out, v);
+    p = *end == ',' ? end + 1 : end;
+  }
+}
+
+typedef struct {
+  char key[16];
+  int order;
+  size_t runs;
+  size_t keys;
+  vec_double filter;  // Per keystroke
+  vec_double render;  // Per keystroke
+  vec_double scan;    // Per invocation that scanned
+  vec_double startup; // Per invocation that showed the selector
+} ReportGroup;
+
+Z_VEC_GENERATE_IMPL(ReportGroup, ReportGroup)
+Z_VEC_GENERATE_SORT(ReportGroup, groups,
+                    a->order != b->order ? a->order < b->order : strcmp(a->key, b->key) < 0)
+
+static ReportGroup *group_for(vec_ReportGroup *groups, const char *key, int order) {
+  ReportGroup *g;
+  vec_foreach(groups, g) {
+    if (strcmp(g->key, key) == 0)
+      return g;
+  }
+  ReportGroup fresh = {0};
+  snprintf(fresh.key, sizeof(fresh.key), "%s", key);
+  fresh.order = order;
+  vec_push_ReportGroup(groups, fresh);
+  return vec_last_ReportGroup(groups);
+}
+
+static const char *size_bucket(size_t entries, int *order) {
+  static const struct {
+    size_t below;
+    const char *name;
+  } buckets[] = {{100, "<100"}, {1000, "100-999"}, {10000, "1k-9.9k"},
+                 {100000, "10k-99k"}, {SIZE_MAX, "100k+"}};
+  int i = 0;
+  while (entries >= buckets[i].below)
+    i++;
+  *order = i;
+  return buckets[i].name;
+}
+
+static void add_run(ReportGroup *g, const char *line, size_t keys) {
+  g->runs++;
+  g->keys += keys;
+  json_numbers(line, "filter_ms", &g->filter);
+  json_numbers(line, "render_ms", &g->render);
+  double scan = json_number(line, "scan_ms");
+  if (scan > 0)
+    vec_push_double(&g->scan, scan);
+  double startup = json_number(line, "startup_ms");
+  if (startup > 0)
+    vec_push_double(&g->startup, startup);
+}
+
+// "p50/p95/p99" (nearest rank), or "-" without samples
+static void cat_percentiles(zstr *out, vec_double *v) {
+  if (v->length == 0) {
+    zstr_fmt(out, " %22s", "-");
+    return;
+  }
+  sort_double(v->data, v->length);
+  const int ps[] = {50, 95, 99};
+  char buf[64];
+  size_t len = 0;
+  for (int i = 0; i < 3; i++) {
+    size_t rank = (v->length * (size_t)ps[i] + 99) / 100;
+    double x = v->data[rank > 0 ? rank - 1 : 0];
+    len += (size_t)snprintf(buf + len, sizeof(buf) - len, i ? "/%.2f" : "%.2f", x);
+  }
+  zstr_fmt(out, " %22s", buf);
+}
+
+static void print_groups(FILE *out, const char *title, vec_ReportGroup *groups) {
+  sort_groups(groups->data, groups->length);
+  Z_CLEANUP(zstr_free) zstr s = zstr_init();
+  zstr_fmt(&s, "%-10s %6s %7s %22s %22s %22s %22s\n", title, "runs", "keys",
+           "filter p50/95/99 ms", "render p50/95/99 ms", "scan p50/95/99 ms",
+           "startup p50/95/99 ms");
+  ReportGroup *g;
+  vec_foreach(groups, g) {
+    zstr_fmt(&s, "%-10s %6zu %7zu", g->key, g->runs, g->keys);
+    cat_percentiles(&s, &g->filter);
+    cat_percentiles(&s, &g->render);
+    cat_percentiles(&s, &g->scan);
+    cat_percentiles(&s, &g->startup);
+    zstr_cat(&s, "\n");
+  }
+  fputs(zstr_cstr(&s), out);
+}
+
+static void free_groups(vec_ReportGroup *groups) {
+  ReportGroup *g;
+  vec_foreach(groups, g) {
+    vec_free_double(&g->filter);
+    vec_free_double(&g->render);
+    vec_free_double(&g->scan);
+    vec_free_double(&g->startup);
+  }
+  vec_free_ReportGroup(groups);
+}
+
+int metrics_report(const char *log_path, FILE *out) {
+  FILE *f = fopen(log_path, "r");
+  if (!f) {
+    fprintf(stderr, "Cannot read metrics log: %s\n", log_path);
+    return 1;
+  }
+
+  vec_ReportGroup weeks = {0};
+  vec_ReportGroup sizes = {0};
+  size_t runs = 0;
+  char *line = NULL;
+  size_t cap = 0;
+  while (getline(&line, &cap, f) > 0) {
+    if (line[0] != '{')
+      continue;
+    time_t ts = (time_t)json_number(line, "ts");
+    size_t keys = (size_t)json_number(line, "keys");
+    size_t entries = (size_t)json_number(line, "entries");
+
+    char week[16];
+    struct tm tm;
+    localtime_r(&ts, &tm);
+    strftime(week, sizeof(week), "%G-W%V", &tm);
+    add_run(group_for(&weeks, week, 0), line, keys);
+
+    int order;
+    const char *bucket = size_bucket(entries, &order);
+    add_run(group_for(&sizes, bucket, order), line, keys);
+    runs++;
+  }
+  free(line);
+  fclose(f);
+
+  if (runs == 0) {
+    fprintf(out, "No runs logged in %s yet.\n", log_path);
+  } else {
+    print_groups(out, "week", &weeks);
+    fputc('\n', out);
+    print_groups(out, "entries", &sizes);
+  }
+  free_groups(&weeks);
+  free_groups(&sizes);
+  return 0;
+}
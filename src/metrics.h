@@ -0,0 +1,53 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Opt-in performance log. With TRY_METRICS_LOG set, every invocation
+// appends one JSON line to that file on exit:
+//
+//   {"ts":..,"version":"..","command":"cd","entries":3000,"startup_ms":..,
+//    "scan_ms":..,"keys":4,"filter_ms":[..],"render_ms":[..],
+//    "action":"cd","total_ms":..}
+//
+// `try perf-report` reads it back (see metrics_report). Unlike --stats the
+// numbers outlive the terminal, so trends show up across weeks and roots.
+
+typedef struct {
+  double start_ms;        // Monotonic time at startup
+  double startup_ms;      // Startup to the first selector frame (0 = none)
+  double scan_ms;         // Time in scan_tries()
+  size_t entries;         // Entries found by the last scan
+  uint32_t keys;          // Keystrokes read by the selector
+  // Per keystroke (the first METRICS_MAX_SAMPLES)
+  float filter_ms[METRICS_MAX_SAMPLES];
+  uint32_t filter_count;
+  float render_ms[METRICS_MAX_SAMPLES];
+  uint32_t render_count;
+  const char *command;
+  const char *action;     // What the selector did (NULL = no selector)
+} TryMetrics;
+
+extern TryMetrics try_metrics;
+extern bool try_metrics_enabled; // TRY_METRICS_LOG is set and the command logs
+
+// Check TRY_METRICS_LOG and, if set, start the clock and arrange for the
+// line to be written at exit
+void metrics_init(void);
+
+// Monotonic milliseconds, for measuring spans
+double metrics_now_ms(void);
+
+// Record one sample (no-op once full)
+void metrics_add_filter(double ms);
+void metrics_add_render(double ms);
+
+// Summarize a log: p50/p95/p99 per week and per root size. Returns 0 on
+// success.
+int metrics_report(const char *log_path, FILE *out);
+
+#endif // METRICS_H
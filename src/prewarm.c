@@ -0,0 +1,283 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "prewarm.h"
+#include "config.h"
+#include "ignore.h"
+#include "index.h"
+#include "libs/zvec_sort.h"
+#include "utils.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern char **environ;
+
+bool try_prewarm_enabled = false;
+
+typedef struct {
+  zstr_view path; // In the walk's NameArena
+  time_t mtime;
+  uint64_t size;
+} WarmFile;
+
+Z_VEC_GENERATE_IMPL(WarmFile, WarmFile)
+Z_VEC_GENERATE_SORT(WarmFile, newest_first, a->mtime > b->mtime)
+
+typedef struct {
+  NameArena names;
+  vec_WarmFile files;
+  const TryIgnore *ignore;
+  size_t scanned;
+} Walk;
+
+// ============================================================================
+// Read-ahead
+// ============================================================================
+
+// Ask for the first len bytes of file to be read into the page cache.
+// The kernel reads asynchronously, so this returns without waiting.
+static bool advise(const char *file, uint64_t len) {
+  int fd = open(file, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+#if defined(__APPLE__)
+  struct radvisory ra = {.ra_offset = 0, .ra_count = len > INT_MAX ? INT_MAX : (int)len};
+  bool ok = fcntl(fd, F_RDADVISE, &ra) == 0;
+#else
+  bool ok = posix_fadvise(fd, 0, (off_t)len, POSIX_FADV_WILLNEED) == 0;
+#endif
+  close(fd);
+  return ok;
+}
+
+// Advise files in order until the budget runs out; the file that crosses
+// it is read ahead only up to the budget. Returns false once it's spent.
+static bool advise_all(const vec_WarmFile *files, uint64_t budget, PrewarmReport *report) {
+  const WarmFile *f;
+  vec_foreach(files, f) {
+    if (report->bytes >= budget)
+      return false;
+    if (f->size == 0)
+      continue;
+    uint64_t len = f->size;
+    if (len > budget - report->bytes)
+      len = budget - report->bytes;
+    if (advise(f->path.data, len)) {
+      report->files++;
+      report->bytes += len;
+    }
+  }
+  return report->bytes < budget;
+}
+
+// ============================================================================
+// Picking files
+// ============================================================================
+
+static void add_file(vec_WarmFile *files, zstr_view path, const struct stat *sb) {
+  WarmFile f = {.path = path, .mtime = sb->st_mtime, .size = (uint64_t)sb->st_size};
+  vec_push_WarmFile(files, f);
+}
+
+// Regular files below dir_path (an open directory, owned), except .git.
+// rel is the directory's path relative to the tries root (rel_len bytes),
+// for ignore rules, as in meta_disk_usage().
+static void walk_dir(Walk *w, int fd, zstr_view dir_path, char *rel, size_t rel_len) {
+  DIR *d = fdopendir(fd);
+  if (!d) {
+    close(fd);
+    return;
+  }
+
+  struct dirent *de;
+  while ((de = readdir(d)) != NULL && w->scanned < PREWARM_MAX_SCAN) {
+    if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0 ||
+        strcmp(de->d_name, ".git") == 0)
+      continue;
+    w->scanned++;
+
+    size_t name_len = strlen(de->d_name);
+    if (rel_len + 1 + name_len >= PATH_MAX)
+      continue;
+    rel[rel_len] = '/';
+    memcpy(rel + rel_len + 1, de->d_name, name_len + 1);
+    size_t child_len = rel_len + 1 + name_len;
+    if (w->ignore && ignore_match(w->ignore, rel, de->d_type == DT_DIR || de->d_type == DT_UNKNOWN))
+      continue;
+
+    struct stat sb;
+    if (fstatat(dirfd(d), de->d_name, &sb, AT_SYMLINK_NOFOLLOW) != 0)
+      continue;
+    if (S_ISREG(sb.st_mode)) {
+      add_file(&w->files, names_join(&w->names, dir_path.data, de->d_name), &sb);
+    } else if (S_ISDIR(sb.st_mode)) {
+      int child = openat(dirfd(d), de->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (child >= 0)
+        walk_dir(w, child, names_join(&w->names, dir_path.data, de->d_name), rel, child_len);
+    }
+  }
+  closedir(d);
+}
+
+// The git directory of the checkout at path (.git, or for a worktree the
+// directory its .git file points at) and the common directory holding
+// objects and refs. False if path isn't a git checkout.
+static bool git_dirs(const char *path, zstr *gitdir, zstr *common) {
+  *gitdir = join_path(path, ".git");
+  struct stat sb;
+  if (stat(zstr_cstr(gitdir), &sb) != 0) {
+    zstr_free(gitdir);
+    return false;
+  }
+  if (S_ISREG(sb.st_mode)) {
+    Z_CLEANUP(zstr_free) zstr link = zstr_read_file(zstr_cstr(gitdir));
+    zstr_free(gitdir);
+    char *target = trim(zstr_data(&link));
+    if (strncmp(target, "gitdir:", 7) != 0)
+      return false;
+    target = trim(target + 7);
+    *gitdir = target[0] == '/' ? zstr_from(target) : join_path(path, target);
+  }
+
+  Z_CLEANUP(zstr_free) zstr commondir_file = join_path(zstr_cstr(gitdir), "commondir");
+  Z_CLEANUP(zstr_free) zstr commondir = zstr_read_file(zstr_cstr(&commondir_file));
+  char *c = trim(zstr_data(&commondir));
+  if (*c == '\0')
+    *common = zstr_dup(gitdir);
+  else
+    *common = c[0] == '/' ? zstr_from(c) : join_path(zstr_cstr(gitdir), c);
+  return true;
+}
+
+// Git metadata, split into what `git status` reads first (index, refs, pack
+// indexes) and the packs themselves, newest first
+static void pick_git(Walk *w, const char *path, vec_WarmFile *meta, vec_WarmFile *packs) {
+  Z_CLEANUP(zstr_free) zstr gitdir = zstr_init();
+  Z_CLEANUP(zstr_free) zstr common = zstr_init();
+  if (!git_dirs(path, &gitdir, &common))
+    return;
+
+  const char *const meta_files[][2] = {
+      {zstr_cstr(&gitdir), "index"}, {zstr_cstr(&gitdir), "HEAD"}, {zstr_cstr(&common), "packed-refs"}};
+  for (size_t i = 0; i < sizeof(meta_files) / sizeof(meta_files[0]); i++) {
+    zstr_view file = names_join(&w->names, meta_files[i][0], meta_files[i][1]);
+    struct stat sb;
+    if (stat(file.data, &sb) == 0 && S_ISREG(sb.st_mode))
+      add_file(meta, file, &sb);
+  }
+
+  Z_CLEANUP(zstr_free) zstr pack_dir = join_path(zstr_cstr(&common), "objects/pack");
+  DIR *d = opendir(zstr_cstr(&pack_dir));
+  if (!d)
+    return;
+  struct dirent *de;
+  while ((de = readdir(d)) != NULL) {
+    size_t len = strlen(de->d_name);
+    bool idx = len > 4 && strcmp(de->d_name + len - 4, ".idx") == 0;
+    bool pack = len > 5 && strcmp(de->d_name + len - 5, ".pack") == 0;
+    if (!idx && !pack)
+      continue;
+    struct stat sb;
+    if (fstatat(dirfd(d), de->d_name, &sb, 0) != 0 || !S_ISREG(sb.st_mode))
+      continue;
+    add_file(idx ? meta : packs, names_join(&w->names, zstr_cstr(&pack_dir), de->d_name), &sb);
+  }
+  closedir(d);
+  sort_newest_first(packs->data, packs->length);
+}
+
+PrewarmReport prewarm_path(const char *path, uint64_t budget) {
+  PrewarmReport report = {0};
+  Walk w = {0};
+
+  // Ignore rules are relative to the tries root, the try's parent
+  Z_CLEANUP(zstr_free) zstr root = zstr_from(path);
+  char *slash = strrchr(zstr_data(&root), '/');
+  const char *name = slash ? slash + 1 : path;
+  if (slash)
+    *slash = '\0';
+  TryIndex idx = index_load(slash ? zstr_cstr(&root) : ".");
+  TryIgnore ignore = ignore_load(slash ? zstr_cstr(&root) : ".", &idx);
+  w.ignore = ignore_empty(&ignore) ? NULL : &ignore;
+
+  vec_WarmFile git_meta = {0};
+  vec_WarmFile git_packs = {0};
+  pick_git(&w, path, &git_meta, &git_packs);
+
+  char rel[PATH_MAX];
+  size_t rel_len = strlen(name);
+  int fd = rel_len < sizeof(rel) ? open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+  if (fd >= 0) {
+    memcpy(rel, name, rel_len + 1);
+    walk_dir(&w, fd, names_add(&w.names, path, strlen(path)), rel, rel_len);
+  }
+  sort_newest_first(w.files.data, w.files.length);
+
+  // Small and needed first; packs can be large and only matter once git
+  // has to look at history
+  if (advise_all(&git_meta, budget, &report) && advise_all(&w.files, budget, &report))
+    advise_all(&git_packs, budget, &report);
+  report.scanned = w.scanned;
+
+  vec_free_WarmFile(&git_meta);
+  vec_free_WarmFile(&git_packs);
+  vec_free_WarmFile(&w.files);
+  names_free(&w.names);
+  ignore_free(&ignore);
+  index_free(&idx);
+  return report;
+}
+
+// ============================================================================
+// Detached helper
+// ============================================================================
+
+void prewarm_spawn(const char *path) {
+  const char *env = getenv("TRY_PREWARM");
+  if (!try_prewarm_enabled && !(env && *env && strcmp(env, "0") != 0))
+    return;
+
+  char exe[PATH_MAX];
+  if (!self_exe_path(exe, sizeof(exe)))
+    return;
+
+  // Nothing inherited may keep the shell waiting: the wrapper reads our
+  // stdout until EOF before it can cd
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+  // Own session (or at least process group), so Ctrl-C in the shell
+  // doesn't reach it
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t none;
+  sigemptyset(&none);
+  posix_spawnattr_setsigmask(&attr, &none);
+  short flags = POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_SETSID
+  flags |= POSIX_SPAWN_SETSID;
+#else
+  flags |= POSIX_SPAWN_SETPGROUP;
+#endif
+  posix_spawnattr_setflags(&attr, flags);
+
+  // Not waited for: try exits right after and the helper is reparented
+  char *argv[] = {exe, "prewarm", (char *)path, NULL};
+  pid_t pid;
+  posix_spawn(&pid, exe, &actions, &attr, argv, environ);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+}
@@ -0,0 +1,30 @@
+#ifndef PREWARM_H
+#define PREWARM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Page-cache prewarm for a try that is about to be entered (--prewarm or
+// TRY_PREWARM=1). The first `git status`, editor open or build after a cd
+// otherwise waits on a cold cache, which hurts on spinning disks and network
+// home directories.
+
+extern bool try_prewarm_enabled;
+
+typedef struct {
+  size_t files;    // Files advised
+  uint64_t bytes;  // Bytes asked to be read ahead
+  size_t scanned;  // Directory entries looked at
+} PrewarmReport;
+
+// Ask the kernel to read ahead the git index, pack indexes and packs of the
+// try at path, and its most recently modified files, newest first, until
+// budget bytes have been requested. Returns once the requests are issued.
+PrewarmReport prewarm_path(const char *path, uint64_t budget);
+
+// Run `try prewarm path` as a detached low-priority process and return at
+// once. No-op unless enabled.
+void prewarm_spawn(const char *path);
+
+#endif // PREWARM_H
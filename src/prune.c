@@ -0,0 +1,191 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "prune.h"
+#include "config.h"
+#include "meta.h"
+#include "scan.h"
+#include "utils.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PRUNE_MAX_THREADS 16
+
+typedef struct {
+  vec_PruneEval *evals;
+  const PruneRules *rules;
+  const TryIgnore *ignore;
+  atomic_size_t next;
+} PruneJob;
+
+// Creation time encoded in a YYYY-MM-DD- prefix (local midnight), or 0
+static time_t date_prefix_time(const char *name) {
+  if (strlen(name) < 11 || name[4] != '-' || name[7] != '-' || name[10] != '-')
+    return 0;
+  for (int i = 0; i < 10; i++) {
+    if (i != 4 && i != 7 && !isdigit((unsigned char)name[i]))
+      return 0;
+  }
+  struct tm tm = {0};
+  tm.tm_year = atoi(name) - 1900;
+  tm.tm_mon = atoi(name + 5) - 1;
+  tm.tm_mday = atoi(name + 8);
+  tm.tm_isdst = -1;
+  time_t t = mktime(&tm);
+  return t == (time_t)-1 ? 0 : t;
+}
+
+// Evaluate one entry, cheapest rules first so expensive work is skipped
+// as soon as the entry can no longer be a candidate
+static void evaluate_one(PruneEval *ev, const PruneRules *rules,
+                         const TryIgnore *ignore) {
+  Z_CLEANUP(zstr_free) zstr pin = join_path(zstr_cstr(&ev->path), PIN_FILE_NAME);
+  ev->pinned = access(zstr_cstr(&pin), F_OK) == 0;
+  if (ev->pinned)
+    return;
+
+  time_t created = date_prefix_time(zstr_cstr(&ev->name));
+  time_t newest = created > ev->mtime ? created : ev->mtime;
+  ev->age_days = (int)(difftime(time(NULL), newest) / 86400);
+  if (rules->older_than_days >= 0 && ev->age_days < rules->older_than_days)
+    return;
+
+  // Always checked afresh: editing a file below the top level doesn't
+  // change the mtime a cached state is validated against, and a stale
+  // "clean" would offer uncommitted work for deletion
+  if (rules->git_clean) {
+    ev->git = meta_git_state(zstr_cstr(&ev->path));
+    if (ev->git != GIT_CLEAN)
+      return;
+  }
+
+  // Size is always shown in the confirmation dialog, so compute it for
+  // every candidate even without a size rule
+  if (!ev->size_known) {
+    ev->size_bytes = meta_disk_usage(zstr_cstr(&ev->path), ignore,
+                                     zstr_cstr(&ev->name));
+    ev->size_known = true;
+  }
+  if (rules->larger_than > 0 && ev->size_bytes < rules->larger_than)
+    return;
+
+  ev->candidate = true;
+
+  // Unchecked only matters for repositories; the dialog says so for those
+  if (ev->git == GIT_UNKNOWN) {
+    Z_CLEANUP(zstr_free) zstr git_path = join_path(zstr_cstr(&ev->path), ".git");
+    if (access(zstr_cstr(&git_path), F_OK) != 0)
+      ev->git = GIT_NONE;
+  }
+}
+
+static void *prune_worker(void *arg) {
+  PruneJob *job = arg;
+  size_t i;
+  while ((i = atomic_fetch_add(&job->next, 1)) < job->evals->length) {
+    evaluate_one(&job->evals->data[i], job->rules, job->ignore);
+  }
+  return NULL;
+}
+
+void prune_evaluate(const char *tries_path, const PruneRules *rules,
+                    vec_PruneEval *out) {
+  vec_TryEntry entries = {0};
+  NameArena names = {0};
+  scan_tries(tries_path, &entries, &names);
+
+  TryIndex idx = index_load(tries_path);
+  TryIgnore ignore = ignore_load(tries_path, &idx);
+  // Matched by identity, so a renamed try keeps its cached values
+  vec_IndexEntryPtr cached_order = {0};
+  scan_reconcile_index(&idx, &entries, &cached_order);
+
+  // Seed evaluations with cached values that are still valid
+  TryEntry *entry;
+  vec_foreach(&entries, entry) {
+    // Tries on a mount that didn't answer can't be measured; the index
+    // keeps what it knows about them and they're left alone
+    if (entry->pending)
+      continue;
+
+    PruneEval ev = {0};
+    ev.name = zstr_from_view(entry->name);
+    ev.path = try_entry_path(tries_path, entry);
+    ev.mtime = entry->mtime;
+    ev.git = GIT_UNKNOWN;
+
+    IndexEntry *cached = index_lookup(&cached_order, entry->name);
+    if (index_is_fresh(cached->size_checked, entry->mtime)) {
+      ev.size_bytes = cached->size_bytes;
+      ev.size_known = true;
+    }
+    if (!rules->git_clean && index_is_fresh(cached->git_checked, entry->mtime))
+      ev.git = cached->git;
+    vec_push_PruneEval(out, ev);
+  }
+  free_try_entries(&entries, &names);
+
+  // Worker pool pulls entries off a shared counter
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int nthreads = ncpu > 1 ? (int)ncpu : 1;
+  if (nthreads > PRUNE_MAX_THREADS)
+    nthreads = PRUNE_MAX_THREADS;
+  if ((size_t)nthreads > out->length)
+    nthreads = (int)out->length;
+
+  PruneJob job = {.evals = out, .rules = rules, .ignore = &ignore};
+  atomic_init(&job.next, 0);
+
+  pthread_t threads[PRUNE_MAX_THREADS];
+  int started = 0;
+  for (int i = 0; i < nthreads; i++) {
+    if (pthread_create(&threads[started], NULL, prune_worker, &job) == 0)
+      started++;
+  }
+  prune_worker(&job); // Help out (and cover thread creation failures)
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  // Write back whatever was computed
+  time_t now = time(NULL);
+  PruneEval *ev;
+  vec_foreach(out, ev) {
+    IndexEntry *cached = index_lookup(&cached_order, zstr_as_view(&ev->name));
+    if (cached->mtime != ev->mtime) {
+      cached->mtime = ev->mtime;
+      idx.dirty = true;
+    }
+    if (ev->size_known && !index_is_fresh(cached->size_checked, ev->mtime)) {
+      cached->size_bytes = ev->size_bytes;
+      cached->size_checked = now;
+      idx.dirty = true;
+    }
+    if (ev->git != GIT_UNKNOWN &&
+        (rules->git_clean || !index_is_fresh(cached->git_checked, ev->mtime))) {
+      cached->git = ev->git;
+      cached->git_checked = now;
+      idx.dirty = true;
+    }
+  }
+  vec_free_IndexEntryPtr(&cached_order);
+  index_save(&idx);
+  index_free(&idx);
+  ignore_free(&ignore);
+}
+
+void prune_free(vec_PruneEval *evals) {
+  PruneEval *ev;
+  vec_foreach(evals, ev) {
+    zstr_free(&ev->name);
+    zstr_free(&ev->path);
+  }
+  vec_free_PruneEval(evals);
+}
@@ -0,0 +1,43 @@
+#ifndef PRUNE_H
+#define PRUNE_H
+
+#include "index.h"
+#include "libs/zstr.h"
+#include "libs/zvec.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Rules for `try prune`. A try is a candidate only if it matches every
+// active rule and is not pinned (contains PIN_FILE_NAME).
+typedef struct {
+  int older_than_days;  // Age from date prefix / mtime, whichever is newer (-1 = off)
+  uint64_t larger_than; // Minimum disk usage in bytes (0 = off)
+  bool git_clean;       // Only git repositories without uncommitted changes
+} PruneRules;
+
+typedef struct {
+  zstr name;
+  zstr path;
+  time_t mtime;
+  int age_days;
+  uint64_t size_bytes;
+  bool size_known;
+  GitState git;
+  bool pinned;
+  bool candidate;
+} PruneEval;
+
+Z_VEC_GENERATE_IMPL(PruneEval, PruneEval)
+
+// Evaluate rules against every try in tries_path on a pool of worker
+// threads. Cached sizes/git status from the index are reused when fresh and
+// newly computed values are written back; with git_clean the git status is
+// always computed, since deleting on a stale one loses work. Results are in
+// scan order.
+void prune_evaluate(const char *tries_path, const PruneRules *rules,
+                    vec_PruneEval *out);
+
+void prune_free(vec_PruneEval *evals);
+
+#endif // PRUNE_H
@@ -0,0 +1,494 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "scan.h"
+#include "alloc_stats.h"
+#include "config.h"
+#include "ignore.h"
+#include "index.h"
+#include "libs/zvec_sort.h"
+#include "metrics.h"
+#include "scratch.h"
+#include "utils.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+Z_VEC_GENERATE_IMPL(zstr_view, zstr_view)
+
+void free_try_entry(TryEntry *entry) {
+  zstr_free(&entry->rendered);
+}
+
+void free_try_entries(vec_TryEntry *entries, NameArena *names) {
+  for (size_t i = 0; i < entries->length; i++) {
+    free_try_entry(&entries->data[i]);
+  }
+  vec_free_TryEntry(entries);
+  names_free(names);
+}
+
+zstr try_entry_path(const char *base_path, const TryEntry *entry) {
+  if (entry->persisted)
+    return scratch_persist_path(base_path, entry->name.data);
+  return join_path(base_path, entry->name.data);
+}
+
+// ============================================================================
+// Deadline-bounded stat()
+// ============================================================================
+
+// A try can be a symlink into a mount that no longer answers (stale NFS,
+// sshfs with the network gone), where stat() blocks indefinitely. The
+// calls run on a small worker pool instead; the scan waits at most
+// SCAN_STAT_TIMEOUT_MS for any one of them and SCAN_DEADLINE_MS for the
+// whole batch, and leaves the rest behind. A worker stuck in the kernel
+// can't be cancelled, so the batch is refcounted and freed by whoever lets
+// go of it last.
+
+enum { JOB_QUEUED, JOB_RUNNING, JOB_DONE };
+
+typedef struct {
+  zstr_view name;         // Points into path
+  zstr_view path;         // In the batch's arena
+  zstr fallback;          // Persisted mirror of a scratch try (or empty)
+  bool is_scratch;
+  // Written by the worker that claimed the job
+  atomic_int state;
+  atomic_llong started_ms; // When its stat() started (JOB_RUNNING)
+  bool ok;                // Is a directory
+  bool used_fallback;
+  time_t mtime;
+  dev_t dev;
+  ino_t ino;
+} StatJob;
+
+typedef struct {
+  StatJob *jobs;
+  size_t count;
+  NameArena names;        // Job paths; outlives the scan if a worker hangs
+  atomic_size_t next;
+  atomic_bool abandoned;  // Scan gave up; don't claim more jobs
+  atomic_int refs;
+  // Per worker: when its current stat() started (0 = idle)
+  atomic_llong started_ms[SCAN_MAX_THREADS];
+  pthread_mutex_t lock;
+  pthread_cond_t cond;    // Signalled when the last job is done
+  atomic_size_t done;
+} StatBatch;
+
+static long long now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void release_batch(StatBatch *b) {
+  if (atomic_fetch_sub(&b->refs, 1) != 1)
+    return;
+  for (size_t i = 0; i < b->count; i++) {
+    zstr_free(&b->jobs[i].fallback);
+  }
+  Z_FREE(b->jobs);
+  names_free(&b->names);
+  pthread_mutex_destroy(&b->lock);
+  pthread_cond_destroy(&b->cond);
+  Z_FREE(b);
+}
+
+static void stat_job(StatJob *job) {
+  // Scratch tries are symlinks into tmpfs. If tmpfs was cleared, fall
+  // back to the copy saved by `try persist`.
+  const char *path = job->path.data;
+  if (job->is_scratch && !dir_exists(path)) {
+    path = zstr_cstr(&job->fallback);
+    job->used_fallback = true;
+  }
+  struct stat sb;
+  job->ok = stat(path, &sb) == 0 && S_ISDIR(sb.st_mode);
+  if (job->ok) {
+    job->mtime = sb.st_mtime;
+    job->dev = sb.st_dev;
+    job->ino = sb.st_ino;
+  }
+}
+
+typedef struct {
+  StatBatch *batch;
+  int slot;
+} WorkerArg;
+
+static void *stat_worker(void *arg) {
+  WorkerArg w = *(WorkerArg *)arg;
+  Z_FREE(arg);
+  StatBatch *b = w.batch;
+  size_t i;
+  while (!atomic_load(&b->abandoned) &&
+         (i = atomic_fetch_add(&b->next, 1)) < b->count) {
+    StatJob *job = &b->jobs[i];
+    long long started = now_ms();
+    atomic_store(&b->started_ms[w.slot], started);
+    atomic_store(&job->started_ms, started);
+    atomic_store(&job->state, JOB_RUNNING);
+    stat_job(job);
+    atomic_store_explicit(&job->state, JOB_DONE, memory_order_release);
+    atomic_store(&b->started_ms[w.slot], 0);
+
+    if (atomic_fetch_add(&b->done, 1) + 1 == b->count) {
+      pthread_mutex_lock(&b->lock);
+      pthread_cond_signal(&b->cond);
+      pthread_mutex_unlock(&b->lock);
+    }
+  }
+  release_batch(b);
+  return NULL;
+}
+
+static bool spawn_worker(StatBatch *b, int slot) {
+  WorkerArg *arg = Z_MALLOC(sizeof(WorkerArg));
+  if (!arg)
+    return false;
+  arg->batch = b;
+  arg->slot = slot;
+  atomic_fetch_add(&b->refs, 1);
+
+  // Signals stay with the main thread (SIGWINCH interrupts read_key())
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  pthread_t t;
+  bool ok = pthread_create(&t, NULL, stat_worker, arg) == 0;
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if (ok) {
+    pthread_detach(t);
+  } else {
+    atomic_fetch_sub(&b->refs, 1);
+    Z_FREE(arg);
+  }
+  return ok;
+}
+
+// Wait until every job is done, every unfinished one is stuck, or the
+// batch deadline passes. A worker that overruns the timeout is replaced so
+// the queue keeps moving.
+static void run_batch(StatBatch *b) {
+  long long deadline = now_ms() + SCAN_DEADLINE_MS;
+  // stat() is cheap on a healthy disk; the threads are there to isolate
+  // hangs, not for throughput, so don't oversubscribe small machines
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int want = ncpu > 1 ? (int)ncpu : 1;
+  if (want > SCAN_STAT_THREADS)
+    want = SCAN_STAT_THREADS;
+  if ((size_t)want > b->count)
+    want = (int)b->count;
+
+  int workers = 0;
+  for (int i = 0; i < want; i++) {
+    if (spawn_worker(b, workers))
+      workers++;
+  }
+  if (workers == 0) {
+    // No threads at all - stat inline rather than show nothing
+    for (size_t i = 0; i < b->count; i++) {
+      stat_job(&b->jobs[i]);
+      atomic_store(&b->jobs[i].state, JOB_DONE);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&b->lock);
+  while (atomic_load(&b->done) < b->count) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_nsec += 10 * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+      until.tv_sec++;
+      until.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&b->cond, &b->lock, &until);
+    if (atomic_load(&b->done) == b->count)
+      break;
+
+    long long now = now_ms();
+    if (now >= deadline)
+      break; // However many calls hang, the first frame can't wait longer
+    int stuck = 0, busy = 0;
+    for (int i = 0; i < workers; i++) {
+      long long started = atomic_load(&b->started_ms[i]);
+      if (started == 0)
+        continue;
+      busy++;
+      if (now - started > SCAN_STAT_TIMEOUT_MS)
+        stuck++;
+    }
+    bool queued = atomic_load(&b->next) < b->count;
+    if (stuck == 0)
+      continue;
+    if (!queued && stuck == busy)
+      break; // Only hung calls left
+    if (queued && stuck >= workers) {
+      if (workers >= SCAN_MAX_THREADS || !spawn_worker(b, workers))
+        break; // Out of workers; the rest is retried next scan
+      workers++;
+    }
+  }
+  pthread_mutex_unlock(&b->lock);
+  atomic_store(&b->abandoned, true);
+}
+
+// ============================================================================
+// Scanning
+// ============================================================================
+
+static bool has_name(const vec_zstr_view *names, const char *name) {
+  for (size_t i = 0; i < names->length; i++) {
+    if (zstr_view_eq(names->data[i], name))
+      return true;
+  }
+  return false;
+}
+
+// An entry whose stat() didn't answer: listed with whatever the index
+// remembers about it
+static void push_pending(vec_TryEntry *entries, zstr_view name,
+                         const IndexEntry *cached, bool is_scratch) {
+  TryEntry entry = {0};
+  entry.name = name;
+  entry.mtime = cached ? cached->mtime : 0;
+  entry.is_scratch = is_scratch;
+  entry.pending = true;
+  vec_push_TryEntry(entries, entry);
+}
+
+void scan_tries(const char *base_path, vec_TryEntry *entries, NameArena *names) {
+  ALLOC_PHASE(ALLOC_SCAN);
+  double scan_start = try_metrics_enabled ? metrics_now_ms() : 0;
+  // Clear existing
+  for (size_t i = 0; i < entries->length; i++) {
+    free_try_entry(&entries->data[i]);
+  }
+  vec_clear_TryEntry(entries);
+  names_free(names);
+
+  DIR *d = opendir(base_path);
+  if (!d)
+    return;
+
+  struct stat base_sb;
+  dev_t base_dev = fstat(dirfd(d), &base_sb) == 0 ? base_sb.st_dev : 0;
+
+  TryIndex idx = index_load(base_path);
+  TryIgnore ignore = ignore_load(base_path, &idx);
+  time_t now = time(NULL);
+
+  // Names the index has seen hang (normally none). The views stay valid
+  // while idx is loaded.
+  vec_zstr_view stale = {0};
+  IndexEntry *ie;
+  vec_foreach(&idx.entries, ie) {
+    if (ie->stale_until != 0)
+      vec_push_zstr_view(&stale, ie->name);
+  }
+
+  StatBatch *b = Z_CALLOC(1, sizeof(StatBatch));
+  pthread_mutex_init(&b->lock, NULL);
+  pthread_cond_init(&b->cond, NULL);
+  atomic_init(&b->next, 0);
+  atomic_init(&b->done, 0);
+  atomic_init(&b->abandoned, false);
+  atomic_init(&b->refs, 1);
+  for (int i = 0; i < SCAN_MAX_THREADS; i++) {
+    atomic_init(&b->started_ms[i], 0);
+  }
+
+  // readdir() and readlink() only touch the tries directory itself, so
+  // listing can't hang on another mount
+  vec_zstr_view skipped = {0};
+  size_t cap = 0;
+  size_t base_len = strlen(base_path);
+  struct dirent *dir;
+  while ((dir = readdir(d)) != NULL) {
+    if (dir->d_name[0] == '.')
+      continue;
+    if (!ignore_empty(&ignore) &&
+        ignore_match(&ignore, dir->d_name, dir->d_type != DT_REG))
+      continue;
+
+    // Recently hung: don't even try until the TTL runs out
+    if (has_name(&stale, dir->d_name)) {
+      IndexEntry *cached = index_find(&idx, dir->d_name);
+      if (cached && cached->stale_until > now) {
+        vec_push_zstr_view(&skipped, names_add(names, dir->d_name, strlen(dir->d_name)));
+        continue;
+      }
+    }
+
+    if (b->count == cap) {
+      cap = cap ? cap * 2 : 64;
+      b->jobs = Z_REALLOC(b->jobs, cap * sizeof(StatJob));
+    }
+    StatJob *job = &b->jobs[b->count++];
+    memset(job, 0, sizeof(*job));
+    job->path = names_join(&b->names, base_path, dir->d_name);
+    job->name = zstr_sub(job->path, base_len + 1, job->path.len - (base_len + 1));
+    if (dir->d_type == DT_LNK || dir->d_type == DT_UNKNOWN) {
+      job->is_scratch = scratch_is_link(job->path.data);
+      if (job->is_scratch)
+        job->fallback = scratch_persist_path(base_path, dir->d_name);
+    }
+    atomic_init(&job->state, JOB_QUEUED);
+    atomic_init(&job->started_ms, 0);
+  }
+  closedir(d);
+
+  if (b->count > 0)
+    run_batch(b);
+  long long scan_done_ms = now_ms();
+
+  for (size_t i = 0; i < b->count; i++) {
+    StatJob *job = &b->jobs[i];
+    int state = atomic_load_explicit(&job->state, memory_order_acquire);
+    const char *name = job->name.data;
+
+    if (state != JOB_DONE) {
+      // Only a call that actually hung marks the entry stale; jobs that
+      // never got a worker, or were cut off by the deadline, are simply
+      // tried again next scan
+      IndexEntry *cached;
+      if (state == JOB_RUNNING &&
+          scan_done_ms - atomic_load(&job->started_ms) > SCAN_STAT_TIMEOUT_MS) {
+        cached = index_upsert(&idx, name);
+        cached->stale_until = now + STALE_MOUNT_TTL_SECONDS;
+        idx.dirty = true;
+      } else {
+        cached = index_find(&idx, name);
+      }
+      push_pending(entries, names_add(names, name, job->name.len), cached,
+                   job->is_scratch);
+      continue;
+    }
+    if (!job->ok)
+      continue;
+
+    TryEntry entry = {0};
+    entry.name = names_add(names, name, job->name.len);
+    entry.mtime = job->mtime;
+    entry.dev = (uint64_t)job->dev;
+    entry.ino = (uint64_t)job->ino;
+    entry.is_scratch = job->is_scratch;
+    entry.persisted = job->used_fallback;
+    entry.score = 0; // Will be calculated in filter
+    vec_push_TryEntry(entries, entry);
+
+    // Remember the mtime of tries on other mounts so they can still be
+    // listed (and ranked) while that mount is unreachable
+    IndexEntry *cached = NULL;
+    if (job->dev != base_dev)
+      cached = index_track(&idx, name, entry.dev, entry.ino);
+    else if (has_name(&stale, name))
+      cached = index_find(&idx, name);
+    if (cached && (cached->mtime != entry.mtime || cached->stale_until != 0)) {
+      cached->mtime = entry.mtime;
+      cached->stale_until = 0;
+      idx.dirty = true;
+    }
+  }
+
+  zstr_view *skip;
+  vec_foreach(&skipped, skip) {
+    push_pending(entries, *skip, index_find(&idx, skip->data), false);
+  }
+
+  release_batch(b);
+  vec_free_zstr_view(&skipped);
+  vec_free_zstr_view(&stale);
+  ignore_free(&ignore);
+  index_save(&idx);
+  index_free(&idx);
+
+  if (try_metrics_enabled) {
+    try_metrics.scan_ms += metrics_now_ms() - scan_start;
+    try_metrics.entries = entries->length;
+  }
+}
+
+// ============================================================================
+// Index reconciliation
+// ============================================================================
+
+// Named so `const T *` in the generators is a pointer to a const pointer
+typedef IndexEntry *IndexEntryRef;
+
+Z_VEC_GENERATE_SORT(IndexEntryRef, IndexById,
+                    (*a)->dev < (*b)->dev || ((*a)->dev == (*b)->dev && (*a)->ino < (*b)->ino))
+
+static IndexEntry *lookup_identity(const vec_IndexEntryPtr *by_id, uint64_t dev,
+                                   uint64_t ino) {
+  if (ino == 0)
+    return NULL;
+  IndexEntry key = {.dev = dev, .ino = ino};
+  IndexEntry *key_ptr = &key;
+  size_t at = lower_bound_IndexById(by_id->data, by_id->length, &key_ptr);
+  if (at == by_id->length || by_id->data[at]->dev != dev || by_id->data[at]->ino != ino)
+    return NULL;
+  return by_id->data[at];
+}
+
+void scan_reconcile_index(TryIndex *idx, const vec_TryEntry *entries,
+                          vec_IndexEntryPtr *sorted) {
+  vec_IndexEntryPtr by_id = {0};
+  index_sort_by_name(idx, &by_id);
+  sort_IndexById(by_id.data, by_id.length);
+  index_sort_by_name(idx, sorted);
+
+  vec_TryEntryPtr renamed = {0};
+  vec_TryEntryPtr added = {0};
+  for (size_t i = 0; i < entries->length; i++) {
+    TryEntry *entry = &entries->data[i];
+    IndexEntry *named = index_lookup(sorted, entry->name);
+    if (entry->pending) {
+      if (named)
+        named->seen = true;
+      continue;
+    }
+    IndexEntry *same = lookup_identity(&by_id, entry->dev, entry->ino);
+    if (same && same == named) {
+      named->seen = true;
+    } else if (!same && named && named->ino == 0) {
+      named->dev = entry->dev;
+      named->ino = entry->ino;
+      named->seen = true;
+      idx->dirty = true;
+    } else if (!same && !named) {
+      vec_push_TryEntryPtr(&added, entry);
+    } else {
+      vec_push_TryEntryPtr(&renamed, entry);
+    }
+  }
+  vec_free_IndexEntryPtr(&by_id);
+
+  // Pointers into idx->entries go stale from here on
+  TryEntry **it;
+  vec_foreach(&renamed, it) {
+    index_track(idx, (*it)->name.data, (*it)->dev, (*it)->ino)->seen = true;
+  }
+  vec_foreach(&added, it) {
+    index_add(idx, (*it)->name.data, (*it)->dev, (*it)->ino)->seen = true;
+  }
+  vec_free_TryEntryPtr(&renamed);
+  vec_free_TryEntryPtr(&added);
+
+  index_drop_unseen(idx);
+  index_sort_by_name(idx, sorted);
+}
@@ -0,0 +1,29 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "index.h"
+#include "tui.h" // Need full definition of TryEntry
+#include "utils.h"
+
+// Fill entries with the try directories in base_path (dotfiles skipped).
+// Entry names are stored in names. Existing entries are freed first.
+void scan_tries(const char *base_path, vec_TryEntry *entries, NameArena *names);
+
+// Match idx to a scan of its root with index_track()'s rules: entries
+// follow renamed tries, new tries get one, and those of removed tries are
+// dropped. Tries that didn't answer (pending) keep theirs as they are.
+// sorted receives the result in name order, for index_lookup(). Only
+// renamed tries go through the linear index_track(); the rest are matched
+// by binary search, so this stays cheap on large roots.
+void scan_reconcile_index(TryIndex *idx, const vec_TryEntry *entries,
+                          vec_IndexEntryPtr *sorted);
+
+// Full path of an entry, for acting on it
+zstr try_entry_path(const char *base_path, const TryEntry *entry);
+
+// Free a single entry's strings, or a whole vector of entries and the
+// names they borrow
+void free_try_entry(TryEntry *entry);
+void free_try_entries(vec_TryEntry *entries, NameArena *names);
+
+#endif // SCAN_H
@@ -0,0 +1,383 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "scratch.h"
+#include "config.h"
+#include "utils.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#define ST_MTIM(sb) ((sb).st_mtimespec)
+#else
+#define ST_MTIM(sb) ((sb).st_mtim)
+#endif
+
+zstr scratch_root(void) {
+  const char *base = getenv("TRY_TMPFS");
+  if (!base || !*base)
+    base = DEFAULT_SCRATCH_TMPFS;
+  zstr root = zstr_from(base);
+  zstr_fmt(&root, "/try-%d", (int)getuid());
+  return root;
+}
+
+bool scratch_is_link(const char *path) {
+  static zstr root = {0};
+  if (zstr_is_empty(&root))
+    root = scratch_root();
+
+  char target[PATH_MAX];
+  ssize_t len = readlink(path, target, sizeof(target) - 1);
+  if (len <= 0)
+    return false;
+  target[len] = '\0';
+
+  size_t root_len = zstr_len(&root);
+  return (size_t)len > root_len &&
+         strncmp(target, zstr_cstr(&root), root_len) == 0 &&
+         target[root_len] == '/';
+}
+
+zstr scratch_persist_path(const char *tries_path, const char *name) {
+  Z_CLEANUP(zstr_free) zstr dir = join_path(tries_path, SCRATCH_PERSIST_DIR);
+  return join_path(zstr_cstr(&dir), name);
+}
+
+// ============================================================================
+// Background copier
+// ============================================================================
+
+// Walking stays on the calling thread; changed files are handed to a single
+// copier thread through a bounded queue so stat and copy I/O overlap.
+
+#define COPY_QUEUE_CAP 64
+
+typedef struct {
+  zstr src;
+  zstr dst;
+  mode_t mode;
+  struct timespec mtime;
+} CopyJob;
+
+typedef struct {
+  CopyJob jobs[COPY_QUEUE_CAP];
+  size_t head;
+  size_t count;
+  bool done;
+  bool inline_copy; // No copier thread - copy synchronously in queue_push()
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  ScratchSyncStats *stats;
+} CopyQueue;
+
+static void copy_job(CopyQueue *q, CopyJob *job);
+
+static void queue_push(CopyQueue *q, CopyJob job) {
+  if (q->inline_copy) {
+    copy_job(q, &job);
+    return;
+  }
+  pthread_mutex_lock(&q->lock);
+  while (q->count == COPY_QUEUE_CAP)
+    pthread_cond_wait(&q->not_full, &q->lock);
+  q->jobs[(q->head + q->count) % COPY_QUEUE_CAP] = job;
+  q->count++;
+  pthread_cond_signal(&q->not_empty);
+  pthread_mutex_unlock(&q->lock);
+}
+
+// Returns false once the queue is drained and closed
+static bool queue_pop(CopyQueue *q, CopyJob *out) {
+  pthread_mutex_lock(&q->lock);
+  while (q->count == 0 && !q->done)
+    pthread_cond_wait(&q->not_empty, &q->lock);
+  if (q->count == 0) {
+    pthread_mutex_unlock(&q->lock);
+    return false;
+  }
+  *out = q->jobs[q->head];
+  q->head = (q->head + 1) % COPY_QUEUE_CAP;
+  q->count--;
+  pthread_cond_signal(&q->not_full);
+  pthread_mutex_unlock(&q->lock);
+  return true;
+}
+
+// Copy contents with copy_file_range where the kernel supports it between
+// these filesystems, falling back to read/write otherwise
+static int copy_contents(int in, int out, uint64_t *bytes) {
+#if defined(__linux__)
+  for (;;) {
+    ssize_t n = copy_file_range(in, NULL, out, NULL, 1 << 30, 0);
+    if (n == 0)
+      return 0;
+    if (n > 0) {
+      *bytes += (uint64_t)n;
+      continue;
+    }
+    if (errno == EINTR)
+      continue;
+    if (errno != EXDEV && errno != ENOSYS && errno != EINVAL &&
+        errno != EOPNOTSUPP)
+      return -1;
+    break; // Unsupported here - fall back (nothing copied yet on these errors)
+  }
+#endif
+  char buf[65536];
+  ssize_t n;
+  while ((n = read(in, buf, sizeof(buf))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    for (ssize_t off = 0; off < n;) {
+      ssize_t w = write(out, buf + off, (size_t)(n - off));
+      if (w < 0) {
+        if (errno == EINTR)
+          continue;
+        return -1;
+      }
+      off += w;
+    }
+    *bytes += (uint64_t)n;
+  }
+  return 0;
+}
+
+static int copy_one(const CopyJob *job, uint64_t *bytes) {
+  int in = open(zstr_cstr(&job->src), O_RDONLY | O_CLOEXEC);
+  if (in < 0)
+    return -1;
+  int out = open(zstr_cstr(&job->dst), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 job->mode & 07777);
+  if (out < 0) {
+    close(in);
+    return -1;
+  }
+
+  int rc = copy_contents(in, out, bytes);
+  if (rc == 0) {
+    // Carry the mtime over so the next sync sees the file as unchanged
+    struct timespec times[2] = {{.tv_sec = 0, .tv_nsec = UTIME_OMIT}, job->mtime};
+    futimens(out, times);
+  }
+  close(in);
+  if (close(out) != 0)
+    rc = -1;
+  return rc;
+}
+
+static void copy_job(CopyQueue *q, CopyJob *job) {
+  uint64_t bytes = 0;
+  int rc = copy_one(job, &bytes);
+
+  pthread_mutex_lock(&q->lock);
+  if (rc == 0) {
+    q->stats->files_copied++;
+    q->stats->bytes_copied += bytes;
+  } else {
+    q->stats->errors++;
+  }
+  pthread_mutex_unlock(&q->lock);
+
+  zstr_free(&job->src);
+  zstr_free(&job->dst);
+}
+
+static void *copier_thread(void *arg) {
+  CopyQueue *q = arg;
+  CopyJob job;
+  while (queue_pop(q, &job)) {
+    copy_job(q, &job);
+  }
+  return NULL;
+}
+
+// ============================================================================
+// Tree walk
+// ============================================================================
+
+static int remove_tree(const char *path) {
+  struct stat sb;
+  if (lstat(path, &sb) != 0)
+    return errno == ENOENT ? 0 : -1;
+  if (!S_ISDIR(sb.st_mode))
+    return unlink(path);
+
+  DIR *d = opendir(path);
+  if (d) {
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+      if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+        continue;
+      Z_CLEANUP(zstr_free) zstr child = join_path(path, de->d_name);
+      remove_tree(zstr_cstr(&child));
+    }
+    closedir(d);
+  }
+  return rmdir(path);
+}
+
+static bool same_mtime(const struct stat *a, const struct stat *b) {
+  return ST_MTIM(*a).tv_sec == ST_MTIM(*b).tv_sec &&
+         ST_MTIM(*a).tv_nsec == ST_MTIM(*b).tv_nsec;
+}
+
+// errors is shared with the copier thread
+static void count_error(CopyQueue *q) {
+  pthread_mutex_lock(&q->lock);
+  q->stats->errors++;
+  pthread_mutex_unlock(&q->lock);
+}
+
+static void sync_dir(const char *src, const char *dst, CopyQueue *q,
+                     ScratchSyncStats *stats) {
+  DIR *d = opendir(src);
+  if (!d) {
+    count_error(q);
+    return;
+  }
+
+  struct dirent *de;
+  while ((de = readdir(d)) != NULL) {
+    if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+      continue;
+
+    Z_CLEANUP(zstr_free) zstr s = join_path(src, de->d_name);
+    Z_CLEANUP(zstr_free) zstr t = join_path(dst, de->d_name);
+    const char *sp = zstr_cstr(&s);
+    const char *tp = zstr_cstr(&t);
+
+    struct stat ss, ts;
+    if (lstat(sp, &ss) != 0)
+      continue; // Vanished while walking
+    bool have_dst = lstat(tp, &ts) == 0;
+
+    if (S_ISDIR(ss.st_mode)) {
+      if (have_dst && !S_ISDIR(ts.st_mode)) {
+        remove_tree(tp);
+        have_dst = false;
+      }
+      if (!have_dst && mkdir(tp, ss.st_mode & 07777) != 0) {
+        count_error(q);
+        continue;
+      }
+      sync_dir(sp, tp, q, stats);
+    } else if (S_ISREG(ss.st_mode)) {
+      if (have_dst && S_ISREG(ts.st_mode) && ts.st_size == ss.st_size &&
+          same_mtime(&ss, &ts)) {
+        stats->files_unchanged++;
+        continue;
+      }
+      if (have_dst && !S_ISREG(ts.st_mode))
+        remove_tree(tp);
+      CopyJob job = {.src = zstr_dup(&s), .dst = zstr_dup(&t),
+                     .mode = ss.st_mode, .mtime = ST_MTIM(ss)};
+      queue_push(q, job);
+    } else if (S_ISLNK(ss.st_mode)) {
+      char target[PATH_MAX];
+      ssize_t len = readlink(sp, target, sizeof(target) - 1);
+      if (len < 0)
+        continue;
+      target[len] = '\0';
+      if (have_dst && S_ISLNK(ts.st_mode)) {
+        char existing[PATH_MAX];
+        ssize_t elen = readlink(tp, existing, sizeof(existing) - 1);
+        if (elen == len && memcmp(existing, target, (size_t)len) == 0)
+          continue;
+      }
+      if (have_dst)
+        remove_tree(tp);
+      if (symlink(target, tp) != 0)
+        count_error(q);
+    }
+    // Sockets, fifos and devices are not persisted
+  }
+  closedir(d);
+
+  // Drop mirror entries whose source is gone
+  d = opendir(dst);
+  if (!d)
+    return;
+  while ((de = readdir(d)) != NULL) {
+    if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+      continue;
+    Z_CLEANUP(zstr_free) zstr s = join_path(src, de->d_name);
+    struct stat ss;
+    if (lstat(zstr_cstr(&s), &ss) != 0 && errno == ENOENT) {
+      Z_CLEANUP(zstr_free) zstr t = join_path(dst, de->d_name);
+      if (remove_tree(zstr_cstr(&t)) == 0)
+        stats->entries_removed++;
+    }
+  }
+  closedir(d);
+}
+
+int scratch_persist(const char *tries_path, const char *name,
+                    ScratchSyncStats *stats) {
+  Z_CLEANUP(zstr_free) zstr link = join_path(tries_path, name);
+  if (!scratch_is_link(zstr_cstr(&link))) {
+    fprintf(stderr, "Not a scratch try: %s\n", name);
+    return -1;
+  }
+
+  struct stat src_sb;
+  if (stat(zstr_cstr(&link), &src_sb) != 0 || !S_ISDIR(src_sb.st_mode)) {
+    fprintf(stderr, "Scratch try is gone (tmpfs cleared?): %s\n", name);
+    return -1;
+  }
+
+  Z_CLEANUP(zstr_free) zstr mirror_dir = join_path(tries_path, SCRATCH_PERSIST_DIR);
+  Z_CLEANUP(zstr_free) zstr mirror = join_path(zstr_cstr(&mirror_dir), name);
+  if (mkdir_p(zstr_cstr(&mirror)) != 0) {
+    fprintf(stderr, "Could not create %s\n", zstr_cstr(&mirror));
+    return -1;
+  }
+
+  CopyQueue q = {0};
+  q.stats = stats;
+  pthread_mutex_init(&q.lock, NULL);
+  pthread_cond_init(&q.not_empty, NULL);
+  pthread_cond_init(&q.not_full, NULL);
+
+  int errors_before = stats->errors;
+
+  pthread_t copier;
+  bool threaded = pthread_create(&copier, NULL, copier_thread, &q) == 0;
+  // Without a thread, queue_push() copies each file as soon as it is found
+  q.inline_copy = !threaded;
+
+  sync_dir(zstr_cstr(&link), zstr_cstr(&mirror), &q, stats);
+
+  if (threaded) {
+    pthread_mutex_lock(&q.lock);
+    q.done = true;
+    pthread_cond_broadcast(&q.not_empty);
+    pthread_mutex_unlock(&q.lock);
+    pthread_join(copier, NULL);
+  }
+
+  pthread_mutex_destroy(&q.lock);
+  pthread_cond_destroy(&q.not_empty);
+  pthread_cond_destroy(&q.not_full);
+
+  // Mirror carries the scratch try's mtime so recency survives a reboot
+  struct timespec times[2] = {{.tv_sec = 0, .tv_nsec = UTIME_OMIT}, ST_MTIM(src_sb)};
+  utimensat(AT_FDCWD, zstr_cstr(&mirror), times, 0);
+
+  return stats->errors > errors_before ? -1 : 0;
+}
@@ -0,0 +1,36 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include "libs/zstr.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// RAM-backed scratch tries: the directory lives on tmpfs (TRY_TMPFS,
+// default /dev/shm) and the tries root holds a symlink to it. `try persist`
+// mirrors it to SCRATCH_PERSIST_DIR inside the root so the work survives a
+// reboot; after that the scan resolves a dangling link to the mirror.
+
+// Directory holding this user's scratch tries, e.g. /dev/shm/try-1000
+zstr scratch_root(void);
+
+// True if path is a symlink into scratch_root()
+bool scratch_is_link(const char *path);
+
+// Mirror location for a scratch try: <tries_path>/SCRATCH_PERSIST_DIR/<name>
+zstr scratch_persist_path(const char *tries_path, const char *name);
+
+typedef struct {
+  uint64_t files_copied;
+  uint64_t bytes_copied;
+  uint64_t files_unchanged;
+  uint64_t entries_removed;
+  int errors;
+} ScratchSyncStats;
+
+// Incrementally sync the scratch try `name` to its mirror. Only files whose
+// size or mtime differ are copied (on a background thread); entries that
+// vanished from the source are removed from the mirror. Returns 0 on success.
+int scratch_persist(const char *tries_path, const char *name,
+                    ScratchSyncStats *stats);
+
+#endif // SCRATCH_H
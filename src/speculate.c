@@ -0,0 +1,158 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "speculate.h"
+#include "config.h"
+#include "fuzzy.h"
+#include "stats.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <strings.h>
+
+bool try_speculate_enabled = false;
+
+typedef struct {
+  zstr query;
+  vec_RankedEntry ranked;
+  vec_TryEntryPtr rest;
+  FilterResult res;
+  bool done; // Ranked to completion (not cut short by a cancel)
+} Branch;
+
+// Worker state. The worker only writes branches; the main thread reads them
+// after pthread_join(), which orders the accesses.
+static pthread_t worker;
+static bool worker_running = false;
+static atomic_bool cancel_flag;
+static Branch branches[SPECULATE_BRANCHES];
+static int branch_count = 0;
+static vec_TryEntry *spec_entries = NULL;
+static zstr spec_query = {0};
+static size_t spec_limit = 0;
+
+static void drop_branches(void) {
+  for (int i = 0; i < branch_count; i++) {
+    zstr_free(&branches[i].query);
+    vec_free_RankedEntry(&branches[i].ranked);
+    vec_free_TryEntryPtr(&branches[i].rest);
+  }
+  branch_count = 0;
+}
+
+// Most frequent characters right after the current match. For an empty
+// query that is the first character of the name proper (past the date).
+static int pick_next_chars(const char *query, char *out, int max) {
+  unsigned counts[256] = {0};
+  for (size_t i = 0; i < spec_entries->length; i++) {
+    if ((i & 255) == 0 && atomic_load_explicit(&cancel_flag, memory_order_relaxed))
+      return 0;
+    const TryEntry *entry = &spec_entries->data[i];
+    int end = fuzzy_match_end(entry, query);
+    if (end < 0)
+      continue;
+    const char *text = entry->name.data;
+    if (!*query && entry->name.len > 11 && text[10] == '-' && isdigit((unsigned char)text[0]))
+      end = 11;
+    unsigned char next = (unsigned char)tolower((unsigned char)text[end]);
+    if (next)
+      counts[next]++;
+  }
+
+  int n = 0;
+  while (n < max) {
+    int best = 0;
+    for (int c = 1; c < 256; c++) {
+      if (counts[c] > counts[best])
+        best = c;
+    }
+    if (counts[best] == 0)
+      break;
+    out[n++] = (char)best;
+    counts[best] = 0;
+  }
+  return n;
+}
+
+static void *worker_main(void *arg) {
+  (void)arg;
+  const char *query = zstr_cstr(&spec_query);
+  char next[SPECULATE_BRANCHES];
+  int n = pick_next_chars(query, next, SPECULATE_BRANCHES);
+
+  for (int i = 0; i < n; i++) {
+    if (atomic_load_explicit(&cancel_flag, memory_order_relaxed))
+      break;
+    Branch *b = &branches[branch_count++];
+    *b = (Branch){.query = zstr_dup(&spec_query)};
+    zstr_push(&b->query, next[i]);
+    b->res = filter_rank_detached(spec_entries, zstr_cstr(&b->query), spec_limit,
+                                  &b->ranked, &b->rest, &cancel_flag);
+    b->done = !atomic_load_explicit(&cancel_flag, memory_order_relaxed);
+  }
+  return NULL;
+}
+
+void speculate_start(vec_TryEntry *entries, const char *query, size_t limit) {
+  speculate_cancel();
+  drop_branches();
+  if (!try_speculate_enabled)
+    return;
+
+  spec_entries = entries;
+  zstr_free(&spec_query);
+  spec_query = zstr_from(query);
+  spec_limit = limit;
+  atomic_store(&cancel_flag, false);
+
+  // Signals stay with the main thread (SIGWINCH interrupts read_key())
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  worker_running = pthread_create(&worker, NULL, worker_main, NULL) == 0;
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+void speculate_cancel(void) {
+  if (!worker_running)
+    return;
+  atomic_store(&cancel_flag, true);
+  pthread_join(worker, NULL);
+  worker_running = false;
+}
+
+bool speculate_take(const char *query, vec_TryEntryPtr *out, FilterResult *res) {
+  if (!try_speculate_enabled)
+    return false;
+  speculate_cancel();
+
+  bool hit = false;
+  for (int i = 0; i < branch_count && !hit; i++) {
+    Branch *b = &branches[i];
+    // Branches are built lowercase; ranking ignores case, so any casing of
+    // the same query has the same result
+    if (b->done && strcasecmp(zstr_cstr(&b->query), query) == 0) {
+      filter_apply(&b->ranked, &b->rest, query, out);
+      *res = b->res;
+      hit = true;
+    }
+  }
+  try_stats.speculation_branches += (uint64_t)branch_count;
+  if (hit)
+    try_stats.speculation_hits++;
+  else
+    try_stats.speculation_misses++;
+  drop_branches();
+  return hit;
+}
+
+void speculate_stop(void) {
+  speculate_cancel();
+  drop_branches();
+  zstr_free(&spec_query);
+}
@@ -0,0 +1,29 @@
+#ifndef SPECULATE_H
+#define SPECULATE_H
+
+#include "filter.h"
+
+// Speculative filtering (--speculate). While the user pauses, a background
+// thread ranks the current query extended by each of the most likely next
+// characters - those that most often follow the current match in the
+// matching names. If the next keystroke lands on one of those branches its
+// results are swapped in instead of filtering again.
+
+extern bool try_speculate_enabled;
+
+// Start speculating on query (cancels any earlier speculation). entries
+// must stay alive and unscanned until speculate_cancel() returns.
+void speculate_start(vec_TryEntry *entries, const char *query, size_t limit);
+
+// Stop the worker as soon as possible; finished branches are kept
+void speculate_cancel(void);
+
+// After speculate_cancel(): if query is a finished branch, publish its
+// results into out (see filter_apply) and return true. Branches are
+// dropped either way.
+bool speculate_take(const char *query, vec_TryEntryPtr *out, FilterResult *res);
+
+// Cancel and drop everything (before the entries are freed)
+void speculate_stop(void);
+
+#endif // SPECULATE_H
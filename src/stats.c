@@ -0,0 +1,36 @@
+#include "stats.h"
+#include "utils.h"
+
+TryStats try_stats = {0};
+bool try_stats_enabled = false;
+
+void stats_report(FILE *f) {
+  if (!try_stats_enabled)
+    return;
+
+  Z_CLEANUP(zstr_free) zstr bytes = format_size(try_stats.bytes_written);
+  fprintf(f, "try stats:\n");
+  fprintf(f, "  frames: %llu rendered, %llu written, %llu dropped (%s)\n",
+          (unsigned long long)try_stats.frames_rendered,
+          (unsigned long long)try_stats.frames_written,
+          (unsigned long long)try_stats.frames_dropped, zstr_cstr(&bytes));
+  if (try_stats.speculation_hits + try_stats.speculation_misses > 0) {
+    fprintf(f, "  speculation: %llu branches, %llu hits, %llu misses\n",
+            (unsigned long long)try_stats.speculation_branches,
+            (unsigned long long)try_stats.speculation_hits,
+            (unsigned long long)try_stats.speculation_misses);
+  }
+  if (try_stats.filters > 0) {
+    fprintf(f, "  filtering: %llu passes, %llu over budget\n",
+            (unsigned long long)try_stats.filters,
+            (unsigned long long)try_stats.filters_truncated);
+  }
+  if (try_stats.engine_passes[0] + try_stats.engine_passes[1] + try_stats.engine_passes[2] > 0) {
+    fprintf(f, "  engine: %llu serial, %llu prefilter, %llu parallel passes, %llu switches "
+               "(%.0f ns/entry)\n",
+            (unsigned long long)try_stats.engine_passes[0],
+            (unsigned long long)try_stats.engine_passes[1],
+            (unsigned long long)try_stats.engine_passes[2],
+            (unsigned long long)try_stats.engine_switches, try_stats.engine_cost_ns);
+  }
+}
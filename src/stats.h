@@ -0,0 +1,39 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Counters for `try --stats`, reported on stderr when the selector exits.
+// Counters touched by more than one thread are updated under the owning
+// module's lock.
+typedef struct {
+  // Frame writer (terminal.c)
+  uint64_t frames_rendered; // Frames handed to the terminal
+  uint64_t frames_written;  // Frames that reached the terminal
+  uint64_t frames_dropped;  // Replaced by a newer frame before being written
+  uint64_t bytes_written;
+
+  // Speculative filtering (speculate.c), counted per query edit
+  uint64_t speculation_branches; // Next-character branches started
+  uint64_t speculation_hits;     // Edits served from a finished branch
+  uint64_t speculation_misses;   // Edits that had to filter again
+
+  // Selector filtering (tui.c)
+  uint64_t filters;           // Filter passes over the tries
+  uint64_t filters_truncated; // Passes that hit FILTER_BUDGET_MS and were refined later
+
+  // Filter engine selection (filter.c)
+  uint64_t engine_passes[3];  // Per FilterEngine (filter.h): serial, prefilter, parallel
+  uint64_t engine_switches;
+  double engine_cost_ns;      // Latest estimate of single-thread cost per entry
+} TryStats;
+
+extern TryStats try_stats;
+extern bool try_stats_enabled; // Set by --stats
+
+// Print the counters (no-op unless try_stats_enabled)
+void stats_report(FILE *f);
+
+#endif // STATS_H
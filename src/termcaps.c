@@ -0,0 +1,287 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
+#include "termcaps.h"
+#include "libs/zstr.h"
+#include "terminal.h"
+#include "utils.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Helper macro to ignore write return values
+#define WRITE(fd, buf, len) do { ssize_t unused = write(fd, buf, len); (void)unused; } while(0)
+
+#define CACHE_HEADER "# try termcaps v1\n"
+#define CACHE_MAX_ENTRIES 16 // Most recent terminals kept in the cache
+#define PROBE_TIMEOUT_MS 500 // Give up if the terminal never answers DA1
+
+static TermCaps caps = {0};
+static bool caps_loaded = false;
+
+const TermCaps *termcaps(void) { return &caps; }
+
+// ============================================================================
+// Cache file
+// ============================================================================
+
+static zstr cache_path(void) {
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  if (xdg && *xdg)
+    return join_path(xdg, "try/termcaps");
+  Z_CLEANUP(zstr_free) zstr home = get_home_dir();
+  if (zstr_is_empty(&home))
+    return zstr_init();
+  return join_path(zstr_cstr(&home), ".cache/try/termcaps");
+}
+
+// TERM, TERM_PROGRAM and TERM_PROGRAM_VERSION joined by tabs
+static zstr cache_key(void) {
+  static const char *vars[] = {"TERM", "TERM_PROGRAM", "TERM_PROGRAM_VERSION"};
+  zstr key = zstr_init();
+  for (int i = 0; i < 3; i++) {
+    const char *value = getenv(vars[i]);
+    if (i > 0)
+      zstr_cat(&key, "\t");
+    // Tabs and newlines would corrupt the line format
+    for (const char *p = value ? value : ""; *p; p++) {
+      zstr_push(&key, (*p == '\t' || *p == '\n') ? ' ' : *p);
+    }
+  }
+  return key;
+}
+
+// Split "key\tsync\tkitty\ttruecolor\temoji" off a cache line; returns the
+// number of leading bytes that form the key, or 0 if the line is malformed
+static size_t parse_line(const char *line, TermCaps *out) {
+  const char *p = line;
+  for (int tabs = 0; tabs < 3; p++) {
+    if (!*p)
+      return 0;
+    if (*p == '\t')
+      tabs++;
+  }
+  size_t key_len = (size_t)(p - line - 1);
+  int sync, kitty, truecolor, emoji;
+  if (sscanf(p, "%d\t%d\t%d\t%d", &sync, &kitty, &truecolor, &emoji) != 4)
+    return 0;
+  *out = (TermCaps){sync != 0, kitty != 0, truecolor != 0, emoji};
+  return key_len;
+}
+
+static bool cache_lookup(const char *path, const zstr *key, TermCaps *out) {
+  FILE *fp = fopen(path, "r");
+  if (!fp)
+    return false;
+  char line[512];
+  bool found = false;
+  while (!found && fgets(line, sizeof(line), fp)) {
+    TermCaps entry;
+    size_t key_len = parse_line(line, &entry);
+    if (key_len == zstr_len(key) && memcmp(line, zstr_cstr(key), key_len) == 0) {
+      *out = entry;
+      found = true;
+    }
+  }
+  fclose(fp);
+  return found;
+}
+
+// Newest entry first; older entries for other terminals are kept up to
+// CACHE_MAX_ENTRIES. Written to a temp file and renamed into place.
+static void cache_store(const char *path, const zstr *key, const TermCaps *entry) {
+  Z_CLEANUP(zstr_free) zstr contents = zstr_from(CACHE_HEADER);
+  zstr_fmt(&contents, "%s\t%d\t%d\t%d\t%d\n", zstr_cstr(key), entry->sync_output,
+           entry->kitty_keyboard, entry->truecolor, entry->emoji_width);
+
+  FILE *fp = fopen(path, "r");
+  if (fp) {
+    char line[512];
+    int kept = 1;
+    while (kept < CACHE_MAX_ENTRIES && fgets(line, sizeof(line), fp)) {
+      TermCaps other;
+      size_t key_len = parse_line(line, &other);
+      if (key_len == 0 || strchr(line, '\n') == NULL)
+        continue;
+      if (key_len == zstr_len(key) && memcmp(line, zstr_cstr(key), key_len) == 0)
+        continue;
+      zstr_cat(&contents, line);
+      kept++;
+    }
+    fclose(fp);
+  }
+
+  // Parent directory (…/try) may not exist yet
+  const char *slash = strrchr(path, '/');
+  if (slash) {
+    Z_CLEANUP(zstr_free) zstr dir = zstr_from_len(path, (size_t)(slash - path));
+    mkdir_p(zstr_cstr(&dir));
+  }
+
+  Z_CLEANUP(zstr_free) zstr tmp = zstr_from(path);
+  zstr_fmt(&tmp, ".%d", (int)getpid());
+  fp = fopen(zstr_cstr(&tmp), "w");
+  if (!fp)
+    return;
+  bool ok = fwrite(zstr_cstr(&contents), 1, zstr_len(&contents), fp) == zstr_len(&contents);
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || rename(zstr_cstr(&tmp), path) != 0)
+    unlink(zstr_cstr(&tmp));
+}
+
+// ============================================================================
+// Probe
+// ============================================================================
+
+static long elapsed_ms(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+// Find "ESC [ ? <digits> <final>" and return a pointer to the digits
+static const char *find_private_csi(const char *buf, char final) {
+  for (const char *p = buf; (p = strstr(p, "\x1b[?")) != NULL; p += 3) {
+    const char *q = p + 3;
+    while ((*q >= '0' && *q <= '9') || *q == ';')
+      q++;
+    if (*q == final)
+      return p + 3;
+  }
+  return NULL;
+}
+
+// Length of the reply starting at p (an ESC), 0 if it isn't one: CSI ? ...
+// c/u/y (DA1, kitty flags, DECRQM), CSI row;col R (cursor position) or
+// DCS ... ST (DECRQSS). A reply cut off by the end of the buffer counts.
+static size_t reply_len(const char *p, const char *end) {
+  if (end - p < 2)
+    return (size_t)(end - p);
+  const char *q = p + 2;
+  if (p[1] == 'P') {
+    for (; q + 1 < end; q++) {
+      if (q[0] == '\x1b' && q[1] == '\\')
+        return (size_t)(q + 2 - p);
+    }
+    return (size_t)(end - p);
+  }
+  if (p[1] != '[')
+    return 0;
+  bool private = q < end && *q == '?';
+  if (private)
+    q++;
+  bool separated = false;
+  for (; q < end && strchr(private ? "0123456789;:$" : "0123456789;", *q) && *q; q++)
+    separated |= *q == ';';
+  if (q == end)
+    return q > p + 2 ? (size_t)(end - p) : 0;
+  if (private && (*q == 'c' || *q == 'u' || *q == 'y'))
+    return (size_t)(q + 1 - p);
+  if (!private && separated && *q == 'R')
+    return (size_t)(q + 1 - p);
+  return 0;
+}
+
+// Send every query in one write, then collect replies until the DA1 answer
+// (which every terminal sends, in order) shows up or the timeout hits.
+// Whatever isn't a reply was typed meanwhile and goes back to read_key().
+// On timeout the replies seen so far still count and anything else is
+// taken as unsupported; read_key() skips replies that arrive later.
+static void probe(TermCaps *out) {
+  static const char queries[] =
+      "\x1b[?2026$p"                             // DECRQM synchronized output
+      "\x1b[?u"                                  // Kitty keyboard flags
+      "\x1b[48;2;1;2;3m\x1bP$qm\x1b\\\x1b[0m"    // DECRQSS: echo back current SGR
+      "\r\xf0\x9f\x8f\xa0\x1b[6n\r\x1b[2K"       // Emoji, then cursor position
+      "\x1b[c";                                  // DA1 (sentinel)
+  WRITE(STDERR_FILENO, queries, sizeof(queries) - 1);
+
+  char buf[512];
+  size_t len = 0;
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  bool done = false;
+  while (!done && len < sizeof(buf) - 1) {
+    long left = PROBE_TIMEOUT_MS - elapsed_ms(&start);
+    if (left <= 0)
+      break;
+    struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+    if (poll(&pfd, 1, (int)left) <= 0)
+      continue; // Timeout or EINTR; the deadline check ends the loop
+    ssize_t n = read(STDIN_FILENO, buf + len, sizeof(buf) - 1 - len);
+    if (n <= 0)
+      break;
+    len += (size_t)n;
+    buf[len] = '\0';
+    done = find_private_csi(buf, 'c') != NULL;
+  }
+
+  // Split replies from keystrokes
+  Z_CLEANUP(zstr_free) zstr replies = zstr_init();
+  Z_CLEANUP(zstr_free) zstr typed = zstr_init();
+  for (size_t i = 0; i < len;) {
+    size_t n = buf[i] == '\x1b' ? reply_len(buf + i, buf + len) : 0;
+    if (n > 0) {
+      zstr_cat_len(&replies, buf + i, n);
+      i += n;
+    } else {
+      zstr_push(&typed, buf[i++]);
+    }
+  }
+  if (!zstr_is_empty(&typed))
+    terminal_unread(zstr_cstr(&typed), zstr_len(&typed));
+  const char *reply = zstr_cstr(&replies);
+
+  *out = (TermCaps){0};
+
+  // "ESC [ ? 2026 ; Ps $ y" - Ps 1 (set) or 2 (reset) means supported
+  const char *sync = strstr(reply, "\x1b[?2026;");
+  if (sync && (sync[8] == '1' || sync[8] == '2'))
+    out->sync_output = true;
+
+  // "ESC [ ? flags u" is only sent by terminals speaking the kitty protocol
+  out->kitty_keyboard = find_private_csi(reply, 'u') != NULL;
+
+  // "ESC P 1 $ r <SGR> ESC \" echoes the colour back only if it was kept
+  const char *sgr = strstr(reply, "\x1bP1$r");
+  if (sgr && (strstr(sgr, "2;1;2;3") || strstr(sgr, "2:1:2:3") ||
+              strstr(sgr, "2::1:2:3")))
+    out->truecolor = true;
+
+  // "ESC [ row ; col R" after printing one emoji from column 1
+  for (const char *p = reply; (p = strstr(p, "\x1b[")) != NULL; p += 2) {
+    int row, col;
+    char final;
+    if (sscanf(p + 2, "%d;%d%c", &row, &col, &final) == 3 && final == 'R') {
+      out->emoji_width = col - 1;
+      break;
+    }
+  }
+}
+
+void termcaps_init(void) {
+  if (caps_loaded)
+    return;
+  caps_loaded = true;
+
+  if (!isatty(STDIN_FILENO) || !isatty(STDERR_FILENO))
+    return;
+
+  Z_CLEANUP(zstr_free) zstr path = cache_path();
+  Z_CLEANUP(zstr_free) zstr key = cache_key();
+  if (!zstr_is_empty(&path) && cache_lookup(zstr_cstr(&path), &key, &caps))
+    return;
+
+  // Cached even if the terminal never answered, so it isn't asked again
+  probe(&caps);
+  if (!zstr_is_empty(&path))
+    cache_store(zstr_cstr(&path), &key, &caps);
+}
@@ -0,0 +1,25 @@
+#ifndef TERMCAPS_H
+#define TERMCAPS_H
+
+#include <stdbool.h>
+
+// Terminal capabilities that can only be discovered by asking the terminal.
+// Asking costs a round trip (slow over SSH), so answers are cached per
+// (TERM, TERM_PROGRAM, TERM_PROGRAM_VERSION) in $XDG_CACHE_HOME/try/termcaps
+// and the terminal is only probed when that key hasn't been seen before.
+typedef struct {
+  bool sync_output;    // Synchronized updates (DEC mode 2026)
+  bool kitty_keyboard; // Kitty progressive keyboard enhancement
+  bool truecolor;      // 24-bit SGR colors
+  int emoji_width;     // Cells a wide emoji occupies (0 = unknown)
+} TermCaps;
+
+// Load cached capabilities or probe the terminal. Needs raw mode (replies
+// arrive on stdin) and should run on the alternate screen, since the emoji
+// width probe prints a glyph. Later calls are free.
+void termcaps_init(void);
+
+// Current capabilities; all false until termcaps_init() has run
+const TermCaps *termcaps(void);
+
+#endif // TERMCAPS_H
@@ -30,7 +30,10 @@
  */
 
 #include "terminal.h"
+#include "stats.h"
 #include <errno.h>
+#include <pthread.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,6 +48,12 @@
 static struct termios orig_termios;
 static int raw_mode_enabled = 0;
 static int alternate_screen_enabled = 0;
+static int kitty_keyboard_enabled = 0;
+
+// Bytes handed back by terminal_unread(), read before stdin
+static char unread_buf[256];
+static size_t unread_len = 0;
+static size_t unread_pos = 0;
 
 // Window size cache
 static int cached_rows = 0;
@@ -56,6 +65,12 @@ static int window_size_valid = 0;
  * Ensures terminal is always restored even on abnormal exit
  */
 static void emergency_cleanup(void) {
+  // Pop our keyboard mode while still on the screen it was pushed on
+  // (kitty keeps separate mode stacks for main and alternate screens)
+  if (kitty_keyboard_enabled) {
+    WRITE(STDERR_FILENO, "\x1b[<u", 4);
+    kitty_keyboard_enabled = 0;
+  }
   // Disable alternate screen first (most critical)
   if (alternate_screen_enabled) {
     WRITE(STDERR_FILENO, "\x1b[?1049l", 9);
@@ -101,6 +116,7 @@ void tui_drain_input(void) {
   drain.c_cc[VTIME] = 1;  // 0.1s timeout to catch late-arriving bytes
   tcsetattr(STDIN_FILENO, TCSANOW, &drain);
 
+  unread_len = unread_pos = 0;
   char discard;
   while (read(STDIN_FILENO, &discard, 1) == 1) {
     // Consume all pending input
@@ -144,6 +160,94 @@ void enable_raw_mode(void) {
   hide_cursor();
 }
 
+/*
+ * Kitty keyboard protocol, "disambiguate" level (CSI > 1 u).
+ * With it enabled the terminal sends Esc as CSI 27 u and ctrl/alt
+ * combinations as CSI <code>;<mods> u, so a bare 0x1b byte always starts
+ * a sequence and ESC no longer needs the VTIME wait to be recognised.
+ * Enter, Tab, Backspace, arrows and plain text keep their legacy encodings,
+ * which read_key() still parses.
+ */
+void enable_kitty_keyboard(void) {
+  if (!kitty_keyboard_enabled) {
+    WRITE(STDERR_FILENO, "\x1b[>1u", 5);
+    kitty_keyboard_enabled = 1;
+  }
+}
+
+void disable_kitty_keyboard(void) {
+  // Pop restores whatever mode was active before we pushed ours
+  if (kitty_keyboard_enabled) {
+    WRITE(STDERR_FILENO, "\x1b[<u", 4);
+    kitty_keyboard_enabled = 0;
+  }
+}
+
+// Map "code[:alternates][;modifiers[:event]][;text]" to a key
+static int parse_csi_u(const char *params) {
+  char *end;
+  long code = strtol(params, &end, 10);
+  while (*end == ':' || (*end >= '0' && *end <= '9'))
+    end++; // Skip alternate key codes
+  long mods = 0;
+  if (*end == ';')
+    mods = strtol(end + 1, NULL, 10) - 1; // Encoded as 1 + bitmask
+  if (mods < 0)
+    mods = 0;
+
+  // Modifier bits: 1 shift, 2 alt, 4 ctrl; anything beyond shift/ctrl
+  // (alt, super, ...) has no meaning in the selector
+  if (mods & ~(1 | 4))
+    return KEY_UNKNOWN;
+  if (mods & 4) {
+    if (code >= 'a' && code <= 'z')
+      return (int)(code & 0x1f); // Same byte the legacy encoding would send
+    return KEY_UNKNOWN;
+  }
+
+  switch (code) {
+  case 27:
+    return ESC_KEY;
+  case 13:
+    return ENTER_KEY;
+  case 9:
+    return '\t';
+  case 127:
+    return BACKSPACE;
+  }
+  if (code >= 32 && code < 127)
+    return (int)code;
+  return KEY_UNKNOWN;
+}
+
+void terminal_unread(const char *buf, size_t len) {
+  // Whatever is still queued goes first; past the buffer, bytes are dropped
+  if (unread_pos > 0) {
+    memmove(unread_buf, unread_buf + unread_pos, unread_len - unread_pos);
+    unread_len -= unread_pos;
+    unread_pos = 0;
+  }
+  if (len > sizeof(unread_buf) - unread_len)
+    len = sizeof(unread_buf) - unread_len;
+  memcpy(unread_buf + unread_len, buf, len);
+  unread_len += len;
+}
+
+// read() on stdin, serving bytes from terminal_unread() first
+static ssize_t input_read(void *buf, size_t len) {
+  if (unread_pos < unread_len) {
+    size_t n = unread_len - unread_pos;
+    if (n > len)
+      n = len;
+    memcpy(buf, unread_buf + unread_pos, n);
+    unread_pos += n;
+    if (unread_pos == unread_len)
+      unread_len = unread_pos = 0;
+    return (ssize_t)n;
+  }
+  return read(STDIN_FILENO, buf, len);
+}
+
 /*
  * Read a single keypress, handling escape sequences.
  * Returns:
@@ -156,11 +260,18 @@ void enable_raw_mode(void) {
  *   the blocking read() with EINTR. We return KEY_RESIZE so the caller
  *   can call get_window_size() and redraw the UI.
  */
+bool key_pending(void) {
+  if (unread_pos < unread_len)
+    return true;
+  struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+  return poll(&pfd, 1, 0) > 0;
+}
+
 int read_key(void) {
   int nread;
   unsigned char c;
   // Blocking read (VMIN=1, VTIME=0 set in enable_raw_mode)
-  while ((nread = read(STDIN_FILENO, &c, 1)) != 1) {
+  while ((nread = input_read(&c, 1)) != 1) {
     if (nread == -1) {
       if (errno == EAGAIN)
         continue;
@@ -199,15 +310,25 @@ int read_key(void) {
     nonblock.c_cc[VTIME] = 1; // 100ms
     tcsetattr(STDIN_FILENO, TCSANOW, &nonblock);
 
-    if (read(STDIN_FILENO, &seq[0], 1) != 1) {
+    if (input_read(&seq[0], 1) != 1) {
       tcsetattr(STDIN_FILENO, TCSANOW, &original_state);
       return '\x1b';
     }
-    if (read(STDIN_FILENO, &seq[1], 1) != 1) {
+    if (input_read(&seq[1], 1) != 1) {
       tcsetattr(STDIN_FILENO, TCSANOW, &original_state);
       return '\x1b';
     }
 
+    // DCS string, e.g. a DECRQSS reply to the termcaps probe arriving late:
+    // skip to its ST (ESC \) rather than type its contents
+    if (seq[0] == 'P') {
+      char prev = seq[1], next;
+      while (input_read(&next, 1) == 1 && !(prev == '\x1b' && next == '\\') && next != '\a')
+        prev = next;
+      tcsetattr(STDIN_FILENO, TCSANOW, &original_state);
+      return KEY_UNKNOWN;
+    }
+
     tcsetattr(STDIN_FILENO, TCSANOW, &original_state);
 
     if (seq[0] == '[') {
@@ -215,7 +336,7 @@ int read_key(void) {
       if (seq[1] == '<') {
         char discard;
         // Consume until 'M' or 'm' (mouse button release/press)
-        while (read(STDIN_FILENO, &discard, 1) == 1) {
+        while (input_read(&discard, 1) == 1) {
           if (discard == 'M' || discard == 'm')
             break;
         }
@@ -224,7 +345,7 @@ int read_key(void) {
       // X10 mouse: \x1b[M followed by 3 bytes
       if (seq[1] == 'M') {
         char discard[3];
-        ssize_t result = read(STDIN_FILENO, discard, 3);  // Consume button + coordinates
+        ssize_t result = input_read(discard, 3);  // Consume button + coordinates
         (void)result;  // Suppress unused result warning
         return KEY_UNKNOWN;
       }
@@ -246,7 +367,7 @@ int read_key(void) {
       // Sequences starting with digit: \x1b[1~ (Home), \x1b[3~ (Del), etc.
       // Also handles urxvt mouse: \x1b[96;32;15M
       if (seq[1] >= '0' && seq[1] <= '9') {
-        if (read(STDIN_FILENO, &seq[2], 1) != 1)
+        if (input_read(&seq[2], 1) != 1)
           return KEY_UNKNOWN;
         if (seq[2] == '~') {
           switch (seq[1]) {
@@ -269,18 +390,26 @@ int read_key(void) {
         }
         // Any other CSI sequence starting with digit - consume until terminator
         // CSI sequences end with a byte in range 0x40-0x7E (@ through ~)
+        // Parameters are kept for kitty key events (CSI ... u)
+        char params[32] = {seq[1]};
+        size_t plen = 1;
         char last = seq[2];
         while (!(last >= 0x40 && last <= 0x7E)) {
-          if (read(STDIN_FILENO, &last, 1) != 1)
+          if (plen < sizeof(params) - 1)
+            params[plen++] = last;
+          if (input_read(&last, 1) != 1)
             break;
         }
+        params[plen] = '\0';
+        if (last == 'u')
+          return parse_csi_u(params);
         return KEY_UNKNOWN;
       }
       // Any other unrecognized CSI sequence - consume until terminator
       if (!(seq[1] >= 0x40 && seq[1] <= 0x7E)) {
         char last = seq[1];
         while (!(last >= 0x40 && last <= 0x7E)) {
-          if (read(STDIN_FILENO, &last, 1) != 1)
+          if (input_read(&last, 1) != 1)
             break;
         }
       }
@@ -373,6 +502,126 @@ void disable_alternate_screen(void) {
   }
 }
 
+// ============================================================================
+// Frame writer
+// ============================================================================
+
+/*
+ * Completed frames go to a dedicated thread through a single-slot mailbox,
+ * so a write(2) stalled on a congested link never blocks key handling or
+ * filtering. A full frame repaints everything, so when one arrives before
+ * the pending frame was written, the stale one is simply dropped. Partial
+ * frames (the input echo) only replace pending partials; behind a pending
+ * full frame they are appended so its list isn't lost.
+ */
+static pthread_t writer_thread;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_wake = PTHREAD_COND_INITIALIZER;  // Frame posted / stop
+static bool writer_running = false;
+static bool writer_stopping = false;
+static bool writer_busy = false;
+static char *pending_frame = NULL;
+static size_t pending_len = 0;
+static bool pending_full = false;
+
+static void write_all(const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(STDERR_FILENO, buf, len);
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      return; // Terminal gone; nothing sensible left to do
+    }
+    buf += n;
+    len -= (size_t)n;
+  }
+}
+
+static void *writer_main(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&writer_lock);
+  for (;;) {
+    while (!pending_frame && !writer_stopping)
+      pthread_cond_wait(&writer_wake, &writer_lock);
+    if (!pending_frame)
+      break; // Stopping with nothing left to write
+
+    char *frame = pending_frame;
+    size_t len = pending_len;
+    pending_frame = NULL;
+    writer_busy = true;
+    pthread_mutex_unlock(&writer_lock);
+
+    write_all(frame, len);
+    free(frame);
+
+    pthread_mutex_lock(&writer_lock);
+    writer_busy = false;
+    try_stats.frames_written++;
+    try_stats.bytes_written += len;
+  }
+  pthread_mutex_unlock(&writer_lock);
+  return NULL;
+}
+
+void terminal_writer_start(void) {
+  if (writer_running)
+    return;
+  writer_stopping = false;
+
+  // Keep SIGWINCH and friends on the main thread, where they interrupt
+  // read_key()
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  writer_running = pthread_create(&writer_thread, NULL, writer_main, NULL) == 0;
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+void terminal_writer_stop(void) {
+  if (!writer_running)
+    return;
+  pthread_mutex_lock(&writer_lock);
+  writer_stopping = true;
+  pthread_cond_signal(&writer_wake);
+  pthread_mutex_unlock(&writer_lock);
+  pthread_join(writer_thread, NULL);
+  writer_running = false;
+}
+
+void terminal_write_frame(FILE *f, char *frame, size_t len, bool full) {
+  try_stats.frames_rendered++;
+  if (!writer_running) {
+    fwrite(frame, 1, len, f);
+    fflush(f);
+    free(frame);
+    try_stats.frames_written++;
+    try_stats.bytes_written += len;
+    return;
+  }
+
+  pthread_mutex_lock(&writer_lock);
+  if (pending_frame && pending_full && !full) {
+    char *merged = realloc(pending_frame, pending_len + len);
+    if (merged) {
+      memcpy(merged + pending_len, frame, len);
+      pending_frame = merged;
+      pending_len += len;
+    }
+    free(frame);
+  } else {
+    if (pending_frame) {
+      free(pending_frame);
+      try_stats.frames_dropped++;
+    }
+    pending_frame = frame;
+    pending_len = len;
+    pending_full = full;
+  }
+  pthread_cond_signal(&writer_wake);
+  pthread_mutex_unlock(&writer_lock);
+}
+
 void clear_screen(void) {
   // Clear screen and home cursor
   ssize_t unused1 = write(STDERR_FILENO, "\x1b[2J", 4);
@@ -1,6 +1,9 @@
 #ifndef TERMINAL_H
 #define TERMINAL_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <termios.h>
 
 // Key definitions
@@ -26,9 +29,23 @@ void disable_raw_mode(void);
 void tui_drain_input(void);  // Consume remaining stdin after TUI exit
 int get_window_size(int *rows, int *cols);
 int read_key(void);
+bool key_pending(void);  // Input is waiting (read_key() won't block)
+// Queue bytes for read_key() ahead of stdin (keys typed while probing)
+void terminal_unread(const char *buf, size_t len);
+void enable_kitty_keyboard(void);  // Only if termcaps() reports support
+void disable_kitty_keyboard(void);
 void enable_alternate_screen(void);
 void disable_alternate_screen(void);
 void clear_screen(void);
+
+// Frame writer: while running, terminal_write_frame() posts frames to a
+// background thread instead of writing them inline. A full repaint replaces
+// any frame not yet written; a partial one only replaces a pending partial.
+void terminal_writer_start(void);
+void terminal_writer_stop(void);  // Writes the last pending frame, then joins
+// Takes ownership of frame, which comes from open_memstream() and so is
+// released with free() rather than Z_FREE()
+void terminal_write_frame(FILE *f, char *frame, size_t len, bool full);
 void hide_cursor(void);
 void show_cursor(void);
 
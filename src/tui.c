@@ -6,35 +6,40 @@
 #endif
 
 #include "tui.h"
+#include "alloc_stats.h"
+#include "filter.h"
 #include "fuzzy.h"
+#include "learn.h"
+#include "maintain.h"
+#include "metrics.h"
+#include "scan.h"
+#include "speculate.h"
+#include "stats.h"
+#include "termcaps.h"
 #include "terminal.h"
 #include "utils.h"
 #include "zvec.h"
 #include <ctype.h>
-#include <dirent.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
 // Helper macro to ignore write return values
 #define WRITE(fd, buf, len) do { ssize_t unused = write(fd, buf, len); (void)unused; } while(0)
 
-// Generate vector implementation for TryEntry
-Z_VEC_GENERATE_IMPL(TryEntry, TryEntry)
-
-// Generate vector implementation for TryEntry pointers
-Z_VEC_GENERATE_IMPL(TryEntry *, TryEntryPtr)
-
 static vec_TryEntry all_tries = {0};
+static NameArena all_names = {0}; // Backs the entries' names
 static vec_TryEntryPtr filtered_ptrs = {0};
 static TuiInput filter_input = {0};
 static int selected_index = 0;
 static int scroll_offset = 0;
 static int marked_count = 0;  // Number of items marked for deletion
+static size_t ranked_count = 0; // Leading filtered_ptrs that are scored and sorted
+static double filter_budget_ms = FILTER_BUDGET_MS; // Per keystroke (0 = unbounded)
+static bool refine_pending = false; // Last pass ran out of budget
 
 // Memoized separator line
 static zstr cached_sep_line = {0};
@@ -63,92 +68,78 @@ static void handle_winch(int sig) {
   (void)sig;
 }
 
-static void free_entry(TryEntry *entry) {
-  zstr_free(&entry->path);
-  zstr_free(&entry->name);
-  zstr_free(&entry->rendered);
-}
-
 static void clear_state(void) {
-  // Free contents of all_tries
-  for (size_t i = 0; i < all_tries.length; i++) {
-    free_entry(&all_tries.data[i]);
-  }
-  vec_free_TryEntry(&all_tries);
+  free_try_entries(&all_tries, &all_names);
 
   // filtered_ptrs just contains pointers, no need to free entries
   vec_free_TryEntryPtr(&filtered_ptrs);
+  ranked_count = 0;
+  refine_pending = false;
 }
 
-static int compare_tries_by_score(const void *a, const void *b) {
-  const TryEntry *const *ta = (const TryEntry *const *)a;
-  const TryEntry *const *tb = (const TryEntry *const *)b;
-  if ((*ta)->score > (*tb)->score)
-    return -1;
-  if ((*ta)->score < (*tb)->score)
-    return 1;
-  return 0;
-}
-
-static void scan_tries(const char *base_path) {
-  // Clear existing
-  for (size_t i = 0; i < all_tries.length; i++) {
-    free_entry(&all_tries.data[i]);
+static void clamp_selection(void) {
+  if (selected_index >= (int)filtered_ptrs.length) {
+    selected_index = 0;
   }
-  vec_clear_TryEntry(&all_tries);
-
-  DIR *d = opendir(base_path);
-  if (!d)
-    return;
-
-  struct dirent *dir;
-  while ((dir = readdir(d)) != NULL) {
-    if (dir->d_name[0] == '.')
-      continue;
+}
 
-    zstr full_path = join_path(base_path, dir->d_name);
+// Rank only as many entries as the list can show from the current scroll
+// position; the rest of the matches stay unsorted until they're needed.
+static size_t visible_limit(void) {
+  int rows, cols;
+  get_window_size(&rows, &cols);
+  (void)cols;
+  return (size_t)(scroll_offset + (rows > 1 ? rows : 1));
+}
 
-    struct stat sb;
-    if (stat(zstr_cstr(&full_path), &sb) == 0 && S_ISDIR(sb.st_mode)) {
-      TryEntry entry = {0};
-      entry.path = full_path; // Move ownership
-      entry.name = zstr_from(dir->d_name);
-      entry.mtime = sb.st_mtime;
-      // Initial render = name (no highlighting)
-      entry.rendered = zstr_dup(&entry.name);
-      entry.score = 0; // Will be calculated in filter
+// Book-keeping after every filter pass: a pass that ran out of budget is
+// refined once the user pauses
+static void note_filter(FilterResult res) {
+  ranked_count = res.ranked;
+  refine_pending = res.truncated;
+  try_stats.filters++;
+  if (res.truncated)
+    try_stats.filters_truncated++;
+  clamp_selection();
+}
 
-      vec_push_TryEntry(&all_tries, entry);
-    } else {
-      zstr_free(&full_path);
-    }
-  }
-  closedir(d);
+static void filter_tries_limit(size_t limit, double budget_ms) {
+  const char *query = tui_input_text(&filter_input);
+  note_filter(filter_rank(&all_tries, query, limit, budget_ms, &filtered_ptrs));
 }
 
 static void filter_tries(void) {
-  vec_clear_TryEntryPtr(&filtered_ptrs);
-  const char *query = zstr_cstr(&filter_input.text);
-
-  TryEntry *iter;
-  vec_foreach(&all_tries, iter) {
-    TryEntry *entry = iter;
-
-    // Update score and rendered string
-    fuzzy_match(entry, query);
-
-    if (zstr_len(&filter_input.text) > 0 && entry->score <= 0.0) {
-      continue;
-    }
+  filter_tries_limit(visible_limit(), filter_budget_ms);
+}
 
-    vec_push_TryEntryPtr(&filtered_ptrs, entry);
+// After a query edit: swap in a finished speculative branch for the new
+// query if there is one, narrow the current matches if text was only added
+// at the end, otherwise filter from scratch
+static void refilter_after_edit(void) {
+  FilterResult res;
+  const char *query = tui_input_text(&filter_input);
+  if (speculate_take(query, &filtered_ptrs, &res)) {
+    note_filter(res);
+  } else if (filter_input.edit.kind == TUI_EDIT_APPEND) {
+    // filtered_ptrs holds every match of the shorter query
+    note_filter(filter_narrow(&all_tries, &filtered_ptrs, query, visible_limit(),
+                              filter_budget_ms, &filtered_ptrs));
+  } else {
+    filter_tries();
   }
+}
 
-  qsort(filtered_ptrs.data, filtered_ptrs.length, sizeof(TryEntry *),
-        compare_tries_by_score);
-
-  if (selected_index >= (int)filtered_ptrs.length) {
-    selected_index = 0;
+// Rank further once the selection or the view moves past the ranked prefix.
+// The limit doubles, so scrolling to the end re-ranks a logarithmic number
+// of times, and each pass keeps the per-keystroke budget. Exact scores keep
+// their order, but a prefix that was ranked by bound can still reorder when
+// it's refined.
+static void ensure_ranked(int upto) {
+  if (upto > (int)ranked_count && ranked_count < filtered_ptrs.length) {
+    size_t limit = ranked_count * 2;
+    if (limit < (size_t)upto)
+      limit = (size_t)upto;
+    filter_tries_limit(limit, filter_budget_ms);
   }
 }
 
@@ -261,25 +252,20 @@ static int read_test_key(TestParams *test) {
 }
 
 // Render confirmation dialog for deletion
-// Returns true if user typed "YES", false otherwise
-static bool render_delete_confirmation(const char *base_path, TestParams *test) {
-  (void)base_path;
-
-  // Collect marked items
-  vec_TryEntryPtr marked_items = {0};
-  for (size_t i = 0; i < filtered_ptrs.length; i++) {
-    if (filtered_ptrs.data[i]->marked_for_delete) {
-      vec_push_TryEntryPtr(&marked_items, filtered_ptrs.data[i]);
-    }
-  }
-
+// details (optional) holds one extra annotation per name, summary (optional)
+// is shown below the list. Returns true if user typed "YES", false otherwise
+static bool render_delete_confirmation(const vec_zstr *names,
+                                       const vec_zstr *details,
+                                       const char *summary, TestParams *test) {
+  ALLOC_PHASE(ALLOC_RENDER);
   TuiInput input = tui_input_init();
   input.placeholder = "YES";
   bool confirmed = false;
   bool is_test = (test && test->inject_keys);
+  bool render_once = (test && test->render_once && !test->inject_keys);
 
   int max_show = 10;
-  if (max_show > (int)marked_items.length) max_show = (int)marked_items.length;
+  if (max_show > (int)names->length) max_show = (int)names->length;
 
   while (1) {
     int rows, cols;
@@ -291,7 +277,7 @@ static bool render_delete_confirmation(const char *base_path, TestParams *test)
     // Title
     TuiStyleString line = tui_screen_line(&t);
     tui_printf(&line, TUI_BOLD, "🗑️  Delete %zu director%s?",
-               marked_items.length, marked_items.length == 1 ? "y" : "ies");
+               names->length, names->length == 1 ? "y" : "ies");
     tui_screen_write(&t, &line);
 
     line = tui_screen_line(&t);
@@ -303,12 +289,22 @@ static bool render_delete_confirmation(const char *base_path, TestParams *test)
     for (int i = 0; i < max_show; i++) {
       line = tui_screen_line(&t);
       tui_print(&line, TUI_DARK, "  - ");
-      tui_print(&line, NULL, zstr_cstr(&marked_items.data[i]->name));
+      tui_print(&line, NULL, zstr_cstr(&names->data[i]));
+      if (details && (size_t)i < details->length) {
+        tui_print(&line, NULL, "  ");
+        tui_print(&line, TUI_DARK, zstr_cstr(&details->data[i]));
+      }
       tui_screen_write(&t, &line);
     }
-    if ((int)marked_items.length > max_show) {
+    if ((int)names->length > max_show) {
       line = tui_screen_line(&t);
-      tui_printf(&line, TUI_DARK, "  ...and %zu more", marked_items.length - max_show);
+      tui_printf(&line, TUI_DARK, "  ...and %zu more", names->length - max_show);
+      tui_screen_write(&t, &line);
+    }
+    if (summary) {
+      tui_screen_empty(&t);
+      line = tui_screen_line(&t);
+      tui_print(&line, TUI_BOLD, summary);
       tui_screen_write(&t, &line);
     }
 
@@ -334,13 +330,17 @@ static bool render_delete_confirmation(const char *base_path, TestParams *test)
 
     tui_free(&t);
 
+    if (render_once) {
+      break;
+    }
+
     // Read key
     int c = is_test ? read_test_key(test) : read_key();
 
     if (c == -1 || c == ESC_KEY || c == 3) {
       break;
     } else if (c == ENTER_KEY) {
-      if (strcmp(zstr_cstr(&input.text), "YES") == 0) {
+      if (strcmp(tui_input_text(&input), "YES") == 0) {
         confirmed = true;
       }
       break;
@@ -349,7 +349,6 @@ static bool render_delete_confirmation(const char *base_path, TestParams *test)
     }
   }
 
-  vec_free_TryEntryPtr(&marked_items);
   tui_input_free(&input);
   return confirmed;
 }
@@ -380,7 +379,8 @@ static int get_date_prefix_len(const char *name) {
 // Render rename dialog for a single entry
 // Returns the new name (with date prefix), or empty zstr if cancelled
 static zstr render_rename_dialog(TryEntry *entry, TestParams *test) {
-  const char *old_name = zstr_cstr(&entry->name);
+  ALLOC_PHASE(ALLOC_RENDER);
+  const char *old_name = entry->name.data;
   int prefix_len = get_date_prefix_len(old_name);
 
   // Extract date prefix and suffix
@@ -402,8 +402,7 @@ static zstr render_rename_dialog(TryEntry *entry, TestParams *test) {
 
   TuiInput input = tui_input_init();
   // Pre-fill with date prefix, cursor at end
-  zstr_cat(&input.text, zstr_cstr(&date_prefix));
-  input.cursor = (int)zstr_len(&input.text);
+  tui_input_insert(&input, zstr_cstr(&date_prefix), zstr_len(&date_prefix));
   // Set placeholder to full old name (shown when input cleared or after cursor)
   input.placeholder = old_name;
 
@@ -462,7 +461,7 @@ static zstr render_rename_dialog(TryEntry *entry, TestParams *test) {
       break;
     } else if (c == ENTER_KEY) {
       // Confirm - return the new name
-      const char *new_text = zstr_cstr(&input.text);
+      const char *new_text = tui_input_text(&input);
       if (strlen(new_text) > 0) {
         // Security: reject any path with /
         if (strchr(new_text, '/') != NULL) {
@@ -486,7 +485,83 @@ static zstr render_rename_dialog(TryEntry *entry, TestParams *test) {
   return result;
 }
 
+// Raw mode + alternate screen for the interactive screens
+static void begin_interactive(void) {
+  enable_raw_mode();
+
+  struct sigaction sa;
+
+  // Handle SIGWINCH (terminal resize)
+  sa.sa_handler = handle_winch;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = 0;
+  sigaction(SIGWINCH, &sa, NULL);
+
+  enable_alternate_screen();
+  // Cached per terminal; only the first launch in a new terminal round-trips
+  termcaps_init();
+  // Unambiguous key events: ESC acts immediately instead of after VTIME
+  if (termcaps()->kitty_keyboard)
+    enable_kitty_keyboard();
+  // Frames are written off the input thread from here on
+  terminal_writer_start();
+}
+
+static void end_interactive(void) {
+  // Let the last frame land before restoring the terminal around it
+  terminal_writer_stop();
+  // Pop the keyboard mode on the screen it was pushed on
+  disable_kitty_keyboard();
+  // Disable alternate screen buffer (restores original screen)
+  disable_alternate_screen();
+  // Reset terminal state
+  disable_raw_mode();
+  // Consume any remaining input (e.g., leftover escape sequences)
+  tui_drain_input();
+  // Reset all attributes
+  tui_write_reset(stderr);
+  fflush(stderr);
+}
+
+bool run_delete_confirmation(const vec_zstr *names, const vec_zstr *details,
+                             const char *summary, TestParams *test) {
+  bool is_test = (test && (test->render_once || test->inject_keys));
+  bool use_tty = !is_test || !test->inject_keys;
+  bool render_only = is_test && test->render_once && !test->inject_keys;
+
+  if (use_tty && !render_only) {
+    begin_interactive();
+  }
+  bool confirmed = render_delete_confirmation(names, details, summary, test);
+  if (use_tty && !render_only) {
+    end_interactive();
+  }
+  return confirmed;
+}
+
+// Screen row of the search line (below the title and a separator)
+#define SEARCH_ROW 3
+
+static void draw_search_line(Tui *t) {
+  TuiStyleString line = tui_screen_line(t);
+  tui_print(&line, TUI_BOLD, "Search:");
+  tui_print(&line, NULL, " ");
+  tui_screen_input(t, &filter_input);
+  tui_clr(line.str);
+  tui_screen_write_truncated(t, &line, "… ");
+}
+
+// First phase of a keystroke: echo the edited query (and place the cursor)
+// before filtering, so typing feels the same on any root size. The full
+// render after filtering repaints the list.
+static void render_search_line(void) {
+  ALLOC_PHASE(ALLOC_RENDER);
+  Z_CLEANUP(tui_free) Tui t = tui_begin_partial(stderr, SEARCH_ROW);
+  draw_search_line(&t);
+}
+
 static void render(const char *base_path) {
+  ALLOC_PHASE(ALLOC_RENDER);
   (void)base_path;
   int rows, cols;
   get_window_size(&rows, &cols);
@@ -504,12 +579,7 @@ static void render(const char *base_path) {
   tui_screen_write_truncated(&t, &line, NULL);
 
   // Search bar with input
-  line = tui_screen_line(&t);
-  tui_print(&line, TUI_BOLD, "Search:");
-  tui_print(&line, NULL, " ");
-  tui_screen_input(&t, &filter_input);
-  tui_clr(line.str);
-  tui_screen_write_truncated(&t, &line, "… ");
+  draw_search_line(&t);
 
   line = tui_screen_line(&t);
   tui_print(&line, TUI_DARK, sep);
@@ -523,6 +593,7 @@ static void render(const char *base_path) {
     scroll_offset = selected_index;
   if (selected_index >= scroll_offset + list_height)
     scroll_offset = selected_index - list_height + 1;
+  ensure_ranked(scroll_offset + list_height);
 
   for (int i = 0; i < list_height; i++) {
     int idx = scroll_offset + i;
@@ -541,7 +612,11 @@ static void render(const char *base_path) {
       }
 
       // Write right-aligned metadata first (will be partially overwritten)
-      Z_CLEANUP(zstr_free) zstr rel_time = format_relative_time(entry->mtime);
+      // Pending entries didn't answer stat(); their time is from the index
+      Z_CLEANUP(zstr_free) zstr rel_time =
+          entry->mtime ? format_relative_time(entry->mtime) : zstr_from("unknown");
+      if (entry->pending)
+        zstr_cat(&rel_time, " (pending)");
       char score_buf[16];
       snprintf(score_buf, sizeof(score_buf), ", %.1f", entry->score);
 
@@ -555,19 +630,25 @@ static void render(const char *base_path) {
       if (line_bg) tui_push(&line, line_bg);
 
       // Render entry prefix and name
+      const char *icon = is_marked          ? "🗑️ "
+                         : entry->pending   ? "⏳ "
+                         : entry->is_scratch ? "⚡ "
+                                             : "📁 ";
       if (is_selected) {
         tui_print(&line, TUI_HIGHLIGHT, "→ ");
-        tui_print(&line, NULL, is_marked ? "🗑️ " : "📁 ");
       } else {
-        tui_print(&line, NULL, is_marked ? "  🗑️ " : "  📁 ");
+        tui_print(&line, NULL, "  ");
       }
-      tui_print(&line, NULL, zstr_cstr(&entry->rendered));
+      tui_print(&line, NULL, icon);
+      // Entries past the ranked prefix haven't been highlighted
+      tui_print(&line, NULL, zstr_is_empty(&entry->rendered) ? entry->name.data
+                                                             : zstr_cstr(&entry->rendered));
       tui_putc(&line, ' ');  // Trailing space (ignored by truncation)
 
       if (line_bg) tui_pop(&line);
       tui_screen_write_truncated(&t, &line, "… ");
 
-    } else if (idx == (int)filtered_ptrs.length && zstr_len(&filter_input.text) > 0) {
+    } else if (idx == (int)filtered_ptrs.length && tui_input_len(&filter_input) > 0) {
       // Separator before "Create new"
       tui_screen_empty(&t);
       i++;
@@ -580,8 +661,8 @@ static void render(const char *base_path) {
 
       Z_CLEANUP(zstr_free) zstr preview = zstr_from(date_prefix);
       zstr_cat(&preview, "-");
-      const char *filter_text = zstr_cstr(&filter_input.text);
-      for (size_t j = 0; j < zstr_len(&filter_input.text); j++) {
+      const char *filter_text = tui_input_text(&filter_input);
+      for (size_t j = 0; filter_text[j]; j++) {
         zstr_push(&preview, isspace(filter_text[j]) ? '-' : filter_text[j]);
       }
 
@@ -620,21 +701,27 @@ SelectionResult run_selector(const char *base_path,
                              const char *initial_filter,
                              TestParams *test) {
   // Initialize filter input
-  if (zstr_len(&filter_input.text) == 0 && !filter_input.text.is_long) {
+  if (!filter_input.buf) {
     filter_input = tui_input_init();
   } else {
     tui_input_clear(&filter_input);
   }
 
   if (initial_filter) {
-    zstr_cat(&filter_input.text, initial_filter);
-    filter_input.cursor = (int)zstr_len(&filter_input.text);
+    tui_input_insert(&filter_input, initial_filter, strlen(initial_filter));
   }
 
-  scan_tries(base_path);
-  filter_tries();
-
   bool is_test = (test && (test->render_once || test->inject_keys));
+  // Test output must not depend on timing
+  filter_budget_ms = is_test ? 0 : FILTER_BUDGET_MS;
+
+  // Learned picks would make test output depend on earlier sessions
+  if (!is_test)
+    learn_open(base_path);
+  scan_tries(base_path, &all_tries, &all_names);
+  filter_tries();
+  bool speculate_pending = true;  // Speculate once the result is on screen
+  bool maintain_pending = !is_test;
 
   // Test mode: render once and exit (only if no keys to inject)
   if (is_test && test->render_once && !test->inject_keys) {
@@ -645,24 +732,39 @@ SelectionResult run_selector(const char *base_path,
 
   // Only setup TTY if not in test mode or if we need to read keys
   if (!is_test || !test->inject_keys) {
-    enable_raw_mode();
-
-    struct sigaction sa;
-
-    // Handle SIGWINCH (terminal resize)
-    sa.sa_handler = handle_winch;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGWINCH, &sa, NULL);
-
-    enable_alternate_screen();
+    begin_interactive();
   }
 
   SelectionResult result = {.type = ACTION_CANCEL, .path = zstr_init()};
 
+  bool first_frame = true;
   while (1) {
     if (!is_test || !test->inject_keys) {
+      double t0 = try_metrics_enabled ? metrics_now_ms() : 0;
       render(base_path);
+      if (try_metrics_enabled) {
+        double t1 = metrics_now_ms();
+        if (first_frame)
+          try_metrics.startup_ms = t1 - try_metrics.start_ms;
+        else
+          metrics_add_render(t1 - t0);
+      }
+      first_frame = false;
+    }
+    if (refine_pending && !key_pending()) {
+      // The last keystroke's ranking was cut short: finish it while idle,
+      // keeping a prefix grown by ensure_ranked()
+      size_t limit = visible_limit();
+      filter_tries_limit(ranked_count > limit ? ranked_count : limit, 0);
+      continue;
+    }
+    if (speculate_pending) {
+      speculate_start(&all_tries, tui_input_text(&filter_input), visible_limit());
+      speculate_pending = false;
+    }
+    if (maintain_pending) {
+      maintain_idle_start(base_path, &all_tries);
+      maintain_pending = false;
     }
 
     // Read key from injected keys or real input
@@ -672,12 +774,16 @@ SelectionResult run_selector(const char *base_path,
     } else {
       c = read_key();
     }
+    // Input arrived: stop speculating right away (finished branches stay)
+    speculate_cancel();
 
     if (c == KEY_RESIZE) {
       // Terminal was resized - continue to re-render with new dimensions
       // get_window_size() is called in render() to get updated size
       continue;
     }
+    if (c != -1)
+      try_metrics.keys++;
     if (c == -1) {
       // End of input (or end of test keys)
       // If we were in render-once mode with keys, render final state now
@@ -715,10 +821,10 @@ SelectionResult run_selector(const char *base_path,
         zstr new_name = render_rename_dialog(entry, test);
         if (zstr_len(&new_name) > 0) {
           // Check if name actually changed
-          if (strcmp(zstr_cstr(&new_name), zstr_cstr(&entry->name)) != 0) {
+          if (strcmp(zstr_cstr(&new_name), entry->name.data) != 0) {
             result.type = ACTION_RENAME;
-            result.path = zstr_dup(&entry->path);
-            result.rename_old_name = zstr_dup(&entry->name);
+            result.path = try_entry_path(base_path, entry);
+            result.rename_old_name = zstr_from_view(entry->name);
             result.rename_new_name = new_name;
             break;
           }
@@ -728,28 +834,36 @@ SelectionResult run_selector(const char *base_path,
     } else if (c == ENTER_KEY) {
       // If items are marked, show confirmation dialog
       if (marked_count > 0) {
-        bool confirmed = render_delete_confirmation(base_path, test);
+        // Collect all marked names
+        // vec_zstr is initialized to 0 via result initialization
+        for (size_t i = 0; i < filtered_ptrs.length; i++) {
+          if (filtered_ptrs.data[i]->marked_for_delete) {
+            vec_push_zstr(&result.delete_names, zstr_from_view(filtered_ptrs.data[i]->name));
+          }
+        }
+        bool confirmed = render_delete_confirmation(&result.delete_names, NULL, NULL, test);
         if (confirmed) {
-          // Collect all marked paths
           result.type = ACTION_DELETE;
-          // vec_zstr is initialized to 0 via result initialization
-          for (size_t i = 0; i < filtered_ptrs.length; i++) {
-            if (filtered_ptrs.data[i]->marked_for_delete) {
-              vec_push_zstr(&result.delete_names, zstr_dup(&filtered_ptrs.data[i]->name));
-            }
-          }
           break;
         }
+        zstr *name;
+        vec_foreach(&result.delete_names, name) {
+          zstr_free(name);
+        }
+        vec_free_zstr(&result.delete_names);
         // Not confirmed - continue (marks cleared by ESC in dialog, or just continue if typed wrong)
         continue;
       }
 
       if (selected_index < (int)filtered_ptrs.length) {
         result.type = ACTION_CD;
-        result.path = zstr_dup(&filtered_ptrs.data[selected_index]->path);
+        result.path = try_entry_path(base_path, filtered_ptrs.data[selected_index]);
+        if (!is_test)
+          learn_record(base_path, tui_input_text(&filter_input),
+                       filtered_ptrs.data[selected_index]->name.data);
       } else {
         // Create new - validate and normalize name first
-        Z_CLEANUP(zstr_free) zstr normalized = normalize_dir_name(zstr_cstr(&filter_input.text));
+        Z_CLEANUP(zstr_free) zstr normalized = normalize_dir_name(tui_input_text(&filter_input));
         if (zstr_len(&normalized) == 0) {
           // Invalid name - don't create directory
           break;
@@ -774,26 +888,39 @@ SelectionResult run_selector(const char *base_path,
         selected_index--;
     } else if (c == ARROW_DOWN || c == 14) {  // DOWN or Ctrl-N
       int max_idx = filtered_ptrs.length;
-      if (zstr_len(&filter_input.text) > 0)
+      if (tui_input_len(&filter_input) > 0)
         max_idx++;
       if (selected_index < max_idx - 1)
         selected_index++;
+      ensure_ranked(selected_index + 1);
     } else if (tui_input_handle_key(&filter_input, c)) {
-      // Input was handled - re-filter
-      filter_tries();
+      // Input was handled - echo it, then re-filter if the text changed
+      if (!is_test || !test->inject_keys) {
+        render_search_line();
+      }
+      if (filter_input.edit.kind != TUI_EDIT_NONE) {
+        double t0 = try_metrics_enabled ? metrics_now_ms() : 0;
+        refilter_after_edit();
+        if (try_metrics_enabled)
+          metrics_add_filter(metrics_now_ms() - t0);
+        speculate_pending = true;
+      }
     }
   }
 
+  // The worker reads all_tries, so it must be gone before they're freed
+  speculate_stop();
+  learn_close();
+  // Before the action touches the index
+  maintain_idle_stop();
+
+  static const char *const action_names[] = {
+      [ACTION_NONE] = "none",     [ACTION_CD] = "cd",         [ACTION_MKDIR] = "mkdir",
+      [ACTION_CANCEL] = "cancel", [ACTION_DELETE] = "delete", [ACTION_RENAME] = "rename"};
+  try_metrics.action = action_names[result.type];
+
   if (!is_test || !test->inject_keys) {
-    // Disable alternate screen buffer (restores original screen)
-    disable_alternate_screen();
-    // Reset terminal state
-    disable_raw_mode();
-    // Consume any remaining input (e.g., leftover escape sequences)
-    tui_drain_input();
-    // Reset all attributes
-    tui_write_reset(stderr);
-    fflush(stderr);
+    end_interactive();
   }
 
   clear_state();
@@ -3,6 +3,7 @@
 
 #include "tui_style.h"
 #include "libs/zvec.h"
+#include <stdint.h>
 #include <time.h>
 
 // Generate vec_zstr type
@@ -22,14 +23,22 @@ typedef enum {
 } ActionType;
 
 typedef struct {
-  zstr path;
-  zstr name;
-  zstr rendered;
+  zstr_view name;   // Borrowed from the scan's NameArena (NUL-terminated)
+  zstr rendered;    // Highlighted name; empty until fuzzy_render()
   time_t mtime;
+  uint64_t dev;     // Directory identity (st_dev, st_ino); 0 if unknown
+  uint64_t ino;
   float score;
   bool marked_for_delete;
+  bool is_scratch;  // Symlink to a tmpfs scratch try (or its persisted mirror)
+  bool persisted;   // Scratch try listed through its persisted mirror
+  bool pending;     // stat() didn't answer in time; mtime is from the index
 } TryEntry;
 
+// Generate vec_TryEntry and vec_TryEntryPtr types
+Z_VEC_GENERATE_IMPL(TryEntry, TryEntry)
+Z_VEC_GENERATE_IMPL(TryEntry *, TryEntryPtr)
+
 typedef struct {
   ActionType type;
   zstr path;
@@ -49,4 +58,10 @@ typedef struct {
 SelectionResult run_selector(const char *base_path, const char *initial_filter,
                              TestParams *test);
 
+// Standalone delete confirmation (used by `try prune`)
+// details (optional) annotates each name, summary (optional) is shown below
+// the list. Returns true if the user typed YES.
+bool run_delete_confirmation(const vec_zstr *names, const vec_zstr *details,
+                             const char *summary, TestParams *test);
+
 #endif /* TUI_H */
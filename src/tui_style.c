@@ -1,7 +1,17 @@
+// Feature test macros for cross-platform compatibility
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#else
+#define _GNU_SOURCE
+#endif
+
 #include "tui_style.h"
+#include "alloc_stats.h"
+#include "termcaps.h"
 #include "terminal.h"
 #include <ctype.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 
 // ============================================================================
@@ -184,22 +194,50 @@ void tui_printf(TuiStyleString *ss, const char *style, const char *fmt, ...) {
 // Screen API
 // ============================================================================
 
-Tui tui_begin_screen(FILE *f) {
+static Tui begin_frame(FILE *f, int row, bool partial) {
   int rows, cols;
   get_window_size(&rows, &cols);
   (void)rows;
-  fputs(ANSI_HIDE_CURSOR ANSI_HOME, f);
-  return (Tui){.file = f,
-               .line_buf = zstr_init(),
-               .row = 1,
-               .cols = cols,
-               .cursor_row = -1,
-               .cursor_col = -1,
-               .line_has_selection = false,
-               .line_has_rwrite = false,
-               .active_input = NULL};
+  Tui t = {.file = f,
+           .out = f,
+           .frame = Z_CALLOC(1, sizeof(TuiFrame)),
+           .partial = partial,
+           .line_buf = zstr_init(),
+           .row = row,
+           .cols = cols,
+           .cursor_row = -1,
+           .cursor_col = -1,
+           .line_has_selection = false,
+           .line_has_rwrite = false,
+           .active_input = NULL};
+
+  // Compose the whole frame in memory; tui_free() hands it to the
+  // terminal writer in one piece
+  if (t.frame) {
+    FILE *mem = open_memstream(&t.frame->buf, &t.frame->len);
+    if (mem) {
+      t.file = mem;
+    } else {
+      Z_FREE(t.frame);
+      t.frame = NULL;
+    }
+  }
+
+  // Let the terminal paint the whole frame at once when it can
+  if (termcaps()->sync_output)
+    fputs(ANSI_SYNC_BEGIN, t.file);
+  fputs(ANSI_HIDE_CURSOR, t.file);
+  if (row > 1)
+    fprintf(t.file, "\033[%d;1H", row);
+  else
+    fputs(ANSI_HOME, t.file);
+  return t;
 }
 
+Tui tui_begin_screen(FILE *f) { return begin_frame(f, 1, false); }
+
+Tui tui_begin_partial(FILE *f, int row) { return begin_frame(f, row, true); }
+
 TuiStyleString tui_screen_line(Tui *t) {
   zstr_clear(&t->line_buf);
   t->line_has_selection = false;
@@ -400,42 +438,42 @@ void tui_screen_empty(Tui *t) {
 void tui_screen_clear_rest(Tui *t) { fputs(ANSI_CLS, t->file); }
 
 void tui_free(Tui *t) {
-  fputs(ANSI_CLS, t->file);  // Clear from cursor to end of screen
+  if (!t->partial)
+    fputs(ANSI_CLS, t->file);  // Clear from cursor to end of screen
   if (t->cursor_row >= 0 && t->cursor_col >= 0) {
     fprintf(t->file, "\033[%d;%dH", t->cursor_row, t->cursor_col);
   }
   fputs(ANSI_SHOW_CURSOR, t->file);
+  if (termcaps()->sync_output)
+    fputs(ANSI_SYNC_END, t->file);
   zstr_free(&t->line_buf);
+
+  if (t->frame) {
+    fclose(t->file);
+    terminal_write_frame(t->out, t->frame->buf, t->frame->len, !t->partial);
+    Z_FREE(t->frame);
+    t->frame = NULL;
+    t->file = t->out;
+  }
 }
 
 void tui_screen_input(Tui *t, TuiInput *input) {
   t->active_input = input;
 
-  const char *text = zstr_cstr(&input->text);
-  int len = (int)zstr_len(&input->text);
+  const char *text = tui_input_text(input);
+  int len = tui_input_len(input);
   int cursor_pos = input->cursor;
   if (cursor_pos < 0)
     cursor_pos = 0;
   if (cursor_pos > len)
     cursor_pos = len;
 
-  // Calculate visual column (skip ANSI codes)
-  int visual_col = 0;
-  const char *p = zstr_cstr(&t->line_buf);
-  while (*p) {
-    if (*p == '\033') {
-      while (*p && *p != 'm')
-        p++;
-      if (*p)
-        p++;
-    } else {
-      visual_col++;
-      p++;
-    }
-  }
+  // Visual column of the prompt and of the cursor within the text
+  int visual_col = visible_width(zstr_cstr(&t->line_buf), zstr_len(&t->line_buf));
+  int cursor_width = visible_width(text, (size_t)cursor_pos);
 
   // Set cursor position (before any text/placeholder)
-  t->cursor_col = visual_col + cursor_pos + 1;
+  t->cursor_col = visual_col + cursor_width + 1;
   t->cursor_row = t->row;
 
   // Check if input matches placeholder prefix
@@ -503,24 +541,173 @@ void tui_flush(FILE *f, zstr *s) { fwrite(zstr_cstr(s), 1, zstr_len(s), f); }
 // Input Field Management
 // ============================================================================
 
+#define INPUT_MIN_CAP 64
+
 TuiInput tui_input_init(void) {
-  return (TuiInput){.text = zstr_init(), .cursor = 0, .placeholder = NULL};
+  return (TuiInput){.cursor = 0, .placeholder = NULL};
 }
 
 void tui_input_free(TuiInput *input) {
-  zstr_free(&input->text);
+  Z_FREE(input->buf);
+  input->buf = NULL;
+  input->cap = input->gap = input->gap_end = 0;
   input->cursor = 0;
+  input->pending_len = 0;
 }
 
 void tui_input_clear(TuiInput *input) {
-  zstr_clear(&input->text);
+  input->gap = 0;
+  input->gap_end = input->cap;
   input->cursor = 0;
+  input->pending_len = 0;
+}
+
+int tui_input_len(const TuiInput *input) {
+  return input->cap - (input->gap_end - input->gap);
+}
+
+// Byte at logical offset i (0 <= i < len)
+static unsigned char input_at(const TuiInput *input, int i) {
+  if (i >= input->gap)
+    i += input->gap_end - input->gap;
+  return (unsigned char)input->buf[i];
+}
+
+static void input_move_gap(TuiInput *input, int pos) {
+  if (pos < input->gap) {
+    int n = input->gap - pos;
+    memmove(input->buf + input->gap_end - n, input->buf + pos, (size_t)n);
+    input->gap = pos;
+    input->gap_end -= n;
+  } else if (pos > input->gap) {
+    int n = pos - input->gap;
+    memmove(input->buf + input->gap, input->buf + input->gap_end, (size_t)n);
+    input->gap += n;
+    input->gap_end += n;
+  }
+}
+
+// Make room for at least `need` bytes in the gap
+static void input_reserve(TuiInput *input, int need) {
+  if (input->gap_end - input->gap >= need)
+    return;
+  int len = tui_input_len(input);
+  int cap = input->cap < INPUT_MIN_CAP ? INPUT_MIN_CAP : input->cap;
+  while (cap - len < need)
+    cap *= 2;
+  char *buf = Z_MALLOC((size_t)cap);
+  if (!buf)
+    abort();
+  int tail = input->cap - input->gap_end;
+  if (input->buf) {
+    memcpy(buf, input->buf, (size_t)input->gap);
+    memcpy(buf + cap - tail, input->buf + input->gap_end, (size_t)tail);
+    Z_FREE(input->buf);
+  }
+  input->buf = buf;
+  input->gap_end = cap - tail;
+  input->cap = cap;
+}
+
+const char *tui_input_text(TuiInput *input) {
+  // One spare byte for the terminator once the gap is at the end
+  input_reserve(input, 1);
+  input_move_gap(input, tui_input_len(input));
+  input->buf[input->gap] = '\0';
+  return input->buf;
+}
+
+static void input_record(TuiInput *input, int old_len, int pos, int removed,
+                         int inserted) {
+  TuiEditKind kind = TUI_EDIT_CHANGE;
+  if (removed == 0 && inserted == 0)
+    kind = TUI_EDIT_NONE;
+  else if (removed == 0 && pos == old_len)
+    kind = TUI_EDIT_APPEND;
+  else if (inserted == 0 && pos + removed == old_len)
+    kind = TUI_EDIT_TRIM;
+  input->edit = (TuiEdit){kind, pos, removed, inserted};
+}
+
+// Remove [start, end) and leave the cursor at start
+static void input_delete(TuiInput *input, int start, int end) {
+  int old_len = tui_input_len(input);
+  input_move_gap(input, end);
+  input->gap = start;
+  input->cursor = start;
+  input_record(input, old_len, start, end - start, 0);
+}
+
+void tui_input_insert(TuiInput *input, const char *text, size_t len) {
+  ALLOC_PHASE(ALLOC_INPUT);
+  int old_len = tui_input_len(input);
+  int pos = input->cursor;
+  input_reserve(input, (int)len);
+  input_move_gap(input, pos);
+  memcpy(input->buf + input->gap, text, len);
+  input->gap += (int)len;
+  input->cursor += (int)len;
+  input_record(input, old_len, pos, 0, (int)len);
+}
+
+static bool is_continuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+static int prev_boundary(const TuiInput *input, int i) {
+  if (i > 0)
+    i--;
+  while (i > 0 && is_continuation(input_at(input, i)))
+    i--;
+  return i;
+}
+
+static int next_boundary(const TuiInput *input, int i) {
+  int len = tui_input_len(input);
+  if (i < len)
+    i++;
+  while (i < len && is_continuation(input_at(input, i)))
+    i++;
+  return i;
+}
+
+// Non-ASCII bytes count as word characters so Ctrl-W takes whole words
+// in any script
+static bool is_word_byte(unsigned char c) { return c >= 0x80 || isalnum(c); }
+
+// Length of the UTF-8 sequence a lead byte starts, 0 if it can't start one
+static int utf8_sequence_len(unsigned char c) {
+  if (c >= 0xC2 && c <= 0xDF)
+    return 2;
+  if (c >= 0xE0 && c <= 0xEF)
+    return 3;
+  if (c >= 0xF0 && c <= 0xF4)
+    return 4;
+  return 0;
 }
 
 bool tui_input_handle_key(TuiInput *input, int key) {
-  zstr *buffer = &input->text;
+  ALLOC_PHASE(ALLOC_INPUT);
   int *cursor = &input->cursor;
-  int len = (int)zstr_len(buffer);
+  int len = tui_input_len(input);
+  input->edit = (TuiEdit){TUI_EDIT_NONE, *cursor, 0, 0};
+
+  // read_key() hands multi-byte characters over one byte at a time
+  if (key >= 0x80 && key <= 0xFF) {
+    unsigned char c = (unsigned char)key;
+    if (is_continuation(c) && input->pending_len > 0) {
+      input->pending[input->pending_len++] = (char)c;
+      if (input->pending_len == utf8_sequence_len((unsigned char)input->pending[0])) {
+        tui_input_insert(input, input->pending, (size_t)input->pending_len);
+        input->pending_len = 0;
+      }
+    } else if (utf8_sequence_len(c) > 0) {
+      input->pending[0] = (char)c;
+      input->pending_len = 1;
+    } else {
+      input->pending_len = 0; // Malformed, drop it
+    }
+    return true;
+  }
+  input->pending_len = 0;
 
   // Navigation
   if (key == 1) { // Ctrl-A (start)
@@ -532,106 +719,51 @@ bool tui_input_handle_key(TuiInput *input, int key) {
     return true;
   }
   if (key == 2 || key == ARROW_LEFT) { // Ctrl-B or LEFT
-    if (*cursor > 0)
-      (*cursor)--;
+    *cursor = prev_boundary(input, *cursor);
     return true;
   }
   if (key == 6 || key == ARROW_RIGHT) { // Ctrl-F or RIGHT
-    if (*cursor < len)
-      (*cursor)++;
+    *cursor = next_boundary(input, *cursor);
     return true;
   }
 
   // Deletion
   if (key == BACKSPACE || key == 8) { // Backspace or Ctrl-H
-    if (*cursor > 0) {
-      char *data = zstr_data(buffer);
-      zstr new_buf = zstr_init();
-      for (int i = 0; i < len; i++) {
-        if (i != *cursor - 1)
-          zstr_push(&new_buf, data[i]);
-      }
-      zstr_free(buffer);
-      *buffer = new_buf;
-      (*cursor)--;
-    }
+    if (*cursor > 0)
+      input_delete(input, prev_boundary(input, *cursor), *cursor);
     return true;
   }
   if (key == DEL_KEY) {
-    if (*cursor < len) {
-      char *data = zstr_data(buffer);
-      zstr new_buf = zstr_init();
-      for (int i = 0; i < len; i++) {
-        if (i != *cursor)
-          zstr_push(&new_buf, data[i]);
-      }
-      zstr_free(buffer);
-      *buffer = new_buf;
-    }
+    if (*cursor < len)
+      input_delete(input, *cursor, next_boundary(input, *cursor));
     return true;
   }
   if (key == 11) { // Ctrl-K (kill to end)
-    if (*cursor < len) {
-      char *data = zstr_data(buffer);
-      zstr new_buf = zstr_init();
-      for (int i = 0; i < *cursor; i++) {
-        zstr_push(&new_buf, data[i]);
-      }
-      zstr_free(buffer);
-      *buffer = new_buf;
-    }
+    if (*cursor < len)
+      input_delete(input, *cursor, len);
     return true;
   }
   if (key == 21) { // Ctrl-U (kill to start)
-    if (*cursor > 0) {
-      char *data = zstr_data(buffer);
-      zstr new_buf = zstr_init();
-      for (int i = *cursor; i < len; i++) {
-        zstr_push(&new_buf, data[i]);
-      }
-      zstr_free(buffer);
-      *buffer = new_buf;
-      *cursor = 0;
-    }
+    if (*cursor > 0)
+      input_delete(input, 0, *cursor);
     return true;
   }
   if (key == 23) { // Ctrl-W (kill word)
     if (*cursor > 0) {
-      char *data = zstr_data(buffer);
-      int end_pos = *cursor - 1;
-      while (end_pos >= 0 && !isalnum((unsigned char)data[end_pos]))
-        end_pos--;
-      int start_pos = end_pos;
-      while (start_pos >= 0 && isalnum((unsigned char)data[start_pos]))
+      int start_pos = *cursor;
+      while (start_pos > 0 && !is_word_byte(input_at(input, start_pos - 1)))
+        start_pos--;
+      while (start_pos > 0 && is_word_byte(input_at(input, start_pos - 1)))
         start_pos--;
-      start_pos++;
-
-      zstr new_buf = zstr_init();
-      for (int i = 0; i < start_pos; i++)
-        zstr_push(&new_buf, data[i]);
-      for (int i = *cursor; i < len; i++)
-        zstr_push(&new_buf, data[i]);
-      zstr_free(buffer);
-      *buffer = new_buf;
-      *cursor = start_pos;
+      input_delete(input, start_pos, *cursor);
     }
     return true;
   }
 
   // Character insertion
-  if (!iscntrl(key) && key >= 32 && key < 127) {
-    char *data = zstr_data(buffer);
-    zstr new_buf = zstr_init();
-    for (int i = 0; i < len; i++) {
-      if (i == *cursor)
-        zstr_push(&new_buf, (char)key);
-      zstr_push(&new_buf, data[i]);
-    }
-    if (*cursor >= len)
-      zstr_push(&new_buf, (char)key);
-    zstr_free(buffer);
-    *buffer = new_buf;
-    (*cursor)++;
+  if (key >= 32 && key < 127) {
+    char ch = (char)key;
+    tui_input_insert(input, &ch, 1);
     return true;
   }
 
@@ -79,6 +79,8 @@
 #define ANSI_HOME "\033[H"
 #define ANSI_HIDE_CURSOR "\033[?25l"
 #define ANSI_SHOW_CURSOR "\033[?25h"
+#define ANSI_SYNC_BEGIN "\033[?2026h" // Synchronized output (see termcaps.h)
+#define ANSI_SYNC_END "\033[?2026l"
 
 // Reset specific attributes
 #define ANSI_RESET_FG "\033[39m"
@@ -123,15 +125,48 @@ typedef struct {
   TuiStyles styles;
 } TuiStyleString;
 
-// Text input field state (forward declare)
+// What the last tui_input_handle_key() did to the text, so callers can
+// update derived state (e.g. filter results) incrementally
+typedef enum {
+  TUI_EDIT_NONE,   // Text unchanged (cursor move, partial UTF-8 sequence)
+  TUI_EDIT_APPEND, // Bytes added at the end
+  TUI_EDIT_TRIM,   // Bytes removed from the end
+  TUI_EDIT_CHANGE  // Anything else
+} TuiEditKind;
+
+typedef struct {
+  TuiEditKind kind;
+  int pos;      // Byte offset where the change starts
+  int removed;  // Bytes removed at pos
+  int inserted; // Bytes inserted at pos
+} TuiEdit;
+
+// Text input field state. The text lives in a gap buffer: buf[0, gap) and
+// buf[gap_end, cap) with the gap kept at the cursor, so typing and pasting
+// only touch the inserted bytes. Read the text with tui_input_text().
 typedef struct {
-  zstr text;
-  int cursor;
+  char *buf;
+  int cap;
+  int gap;
+  int gap_end;
+  int cursor;               // Byte offset, always on a codepoint boundary
   const char *placeholder;  // Optional placeholder shown when empty
+  TuiEdit edit;             // Set by tui_input_handle_key()
+  char pending[4];          // UTF-8 sequence still being read
+  int pending_len;
 } TuiInput;
 
+// open_memstream() target; heap-allocated so Tui can be passed by value
+typedef struct {
+  char *buf;
+  size_t len;
+} TuiFrame;
+
 typedef struct {
-  FILE *file;
+  FILE *file;      // Frame being composed (in memory when possible)
+  FILE *out;       // Where the finished frame goes
+  TuiFrame *frame; // Buffer behind file, NULL when writing to out directly
+  bool partial;    // Repaints some rows only (see tui_begin_partial)
   zstr line_buf;
   int row;
   int cols;  // Terminal width
@@ -161,6 +196,9 @@ void tui_printf(TuiStyleString *ss, const char *style, const char *fmt, ...)
     __attribute__((format(printf, 3, 4)));
 
 Tui tui_begin_screen(FILE *f);
+// Repaint only the lines written, starting at the given 1-based row; the
+// rest of the screen is left alone
+Tui tui_begin_partial(FILE *f, int row);
 TuiStyleString tui_screen_line(Tui *t);
 TuiStyleString tui_screen_line_selected(Tui *t);
 void tui_screen_write(Tui *t, TuiStyleString *line);
@@ -176,6 +214,11 @@ void tui_screen_input(Tui *t, TuiInput *input);
 TuiInput tui_input_init(void);
 void tui_input_free(TuiInput *input);
 void tui_input_clear(TuiInput *input);
+// NUL-terminated text; valid until the next edit
+const char *tui_input_text(TuiInput *input);
+int tui_input_len(const TuiInput *input);
+// Insert at the cursor and move the cursor past it
+void tui_input_insert(TuiInput *input, const char *text, size_t len);
 bool tui_input_handle_key(TuiInput *input, int key);
 
 // Convenience: handle key for active input on screen
@@ -1,6 +1,7 @@
 // Feature test macros for cross-platform compatibility
 #if defined(__APPLE__)
 #define _DARWIN_C_SOURCE
+#include <mach-o/dyld.h>
 #else
 #define _GNU_SOURCE
 #endif
@@ -47,6 +48,71 @@ zstr join_path(const char *dir, const char *file) {
   return s;
 }
 
+#define NAME_CHUNK_SIZE 16384
+
+struct NameChunk {
+  NameChunk *next;
+  size_t used;
+  size_t cap;
+  char data[];
+};
+
+// Room for len bytes plus a terminator, NULL if out of memory
+static char *names_reserve(NameArena *names, size_t len) {
+  NameChunk *c = names->chunks;
+  if (!c || c->cap - c->used < len + 1) {
+    size_t cap = len + 1 > NAME_CHUNK_SIZE ? len + 1 : NAME_CHUNK_SIZE;
+    c = Z_MALLOC(sizeof(NameChunk) + cap);
+    if (!c)
+      return NULL;
+    c->next = names->chunks;
+    c->used = 0;
+    c->cap = cap;
+    names->chunks = c;
+  }
+  char *p = c->data + c->used;
+  c->used += len + 1;
+  p[len] = '\0';
+  return p;
+}
+
+zstr_view names_add(NameArena *names, const char *s, size_t len) {
+  char *p = names_reserve(names, len);
+  if (!p)
+    return (zstr_view){"", 0};
+  memcpy(p, s, len);
+  return (zstr_view){p, len};
+}
+
+zstr_view names_join(NameArena *names, const char *dir, const char *file) {
+  size_t dir_len = strlen(dir), file_len = strlen(file);
+  char *p = names_reserve(names, dir_len + 1 + file_len);
+  if (!p)
+    return (zstr_view){"", 0};
+  memcpy(p, dir, dir_len);
+  p[dir_len] = '/';
+  memcpy(p + dir_len + 1, file, file_len);
+  return (zstr_view){p, dir_len + 1 + file_len};
+}
+
+void names_free(NameArena *names) {
+  NameChunk *c = names->chunks;
+  while (c) {
+    NameChunk *next = c->next;
+    Z_FREE(c);
+    c = next;
+  }
+  names->chunks = NULL;
+}
+
+int view_cmp(zstr_view a, zstr_view b) {
+  size_t n = a.len < b.len ? a.len : b.len;
+  int c = memcmp(a.data, b.data, n);
+  if (c != 0)
+    return c;
+  return a.len < b.len ? -1 : a.len > b.len;
+}
+
 zstr get_default_tries_path(void) {
   Z_CLEANUP(zstr_free) zstr home = get_home_dir();
   if (zstr_is_empty(&home))
@@ -66,6 +132,21 @@ bool file_exists(const char *path) {
   return (stat(path, &sb) == 0 && S_ISREG(sb.st_mode));
 }
 
+bool self_exe_path(char *buf, size_t size) {
+  // /proc/self/exe on Linux
+  ssize_t len = readlink("/proc/self/exe", buf, size - 1);
+  if (len != -1) {
+    buf[len] = '\0';
+    return true;
+  }
+#ifdef __APPLE__
+  uint32_t apple_size = (uint32_t)size;
+  if (_NSGetExecutablePath(buf, &apple_size) == 0)
+    return true;
+#endif
+  return false;
+}
+
 int mkdir_p(const char *path) {
   Z_CLEANUP(zstr_free) zstr tmp = zstr_from(path);
   
@@ -114,6 +195,44 @@ zstr format_relative_time(time_t mtime) {
   return s;
 }
 
+zstr format_size(uint64_t bytes) {
+  static const char units[] = "BKMGT";
+  double value = (double)bytes;
+  int unit = 0;
+  while (value >= 1024 && unit < (int)sizeof(units) - 2) {
+    value /= 1024;
+    unit++;
+  }
+  zstr s = zstr_init();
+  if (unit == 0 || value >= 10) {
+    zstr_fmt(&s, "%.0f%c", value, units[unit]);
+  } else {
+    zstr_fmt(&s, "%.1f%c", value, units[unit]);
+  }
+  return s;
+}
+
+// Parse a --flag=value or --flag value option, returns value or NULL
+// Sets *skip to 1 if value was in next arg (so caller can skip it)
+const char *parse_option_value(const char *arg, const char *next_arg,
+                               const char *flag, int *skip) {
+  size_t flag_len = strlen(flag);
+  *skip = 0;
+
+  // Check --flag=value form
+  if (strncmp(arg, flag, flag_len) == 0 && arg[flag_len] == '=') {
+    return arg + flag_len + 1;
+  }
+
+  // Check --flag value form
+  if (strcmp(arg, flag) == 0 && next_arg != NULL) {
+    *skip = 1;
+    return next_arg;
+  }
+
+  return NULL;
+}
+
 // Check if a character is valid for directory names
 // Valid: alphanumeric, underscore, hyphen, dot
 static bool is_valid_dir_char(char c) {
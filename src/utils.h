@@ -5,6 +5,7 @@
 #include "libs/zvec.h"
 #include "tui.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <time.h>
 
@@ -23,11 +24,34 @@ zstr join_path(const char *dir, const char *file);
 zstr get_home_dir(void);
 zstr get_default_tries_path(void);
 
+// Append-only storage for many small strings. Strings are packed into
+// chunks that never move, so the views handed out stay valid (and
+// NUL-terminated) until names_free().
+typedef struct NameChunk NameChunk;
+typedef struct {
+  NameChunk *chunks;
+} NameArena;
+
+zstr_view names_add(NameArena *names, const char *s, size_t len);
+zstr_view names_join(NameArena *names, const char *dir, const char *file);
+void names_free(NameArena *names);
+
+// Byte-wise order of two names (shorter first on a common prefix), <0/0/>0
+int view_cmp(zstr_view a, zstr_view b);
+
 // File helpers
 bool dir_exists(const char *path);
 bool file_exists(const char *path);
 int mkdir_p(const char *path);
 zstr format_relative_time(time_t mtime);
+zstr format_size(uint64_t bytes); // e.g. "512K", "1.2G"
+bool self_exe_path(char *buf, size_t size); // This executable, false if unknown
+
+// Option parsing
+// Parse a --flag=value or --flag value option, returns value or NULL
+// Sets *skip to 1 if value was in next arg (so caller can skip it)
+const char *parse_option_value(const char *arg, const char *next_arg,
+                               const char *flag, int *skip);
 
 // Directory name validation
 // Returns normalized name (spaces -> hyphens, collapse multiples, strip edges)
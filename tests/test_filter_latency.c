@@ -0,0 +1,143 @@
+// Per-keystroke ranking latency on corpora built to defeat the ranker's
+// shortcuts: every name matching, names differing only at the end, and
+// names long enough to leave the scoring tables. Queries are typed one
+// character at a time and ranked the way the selector does it (rank,
+// then narrow while text is appended), within FILTER_BUDGET_MS.
+
+#define _GNU_SOURCE
+
+#include "acutest.h"
+#include "config.h"
+#include "filter.h"
+#include "scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Defined by main.c in the real binary
+bool tui_no_colors = false;
+
+// Entries per corpus, rows the list shows, and the p99 the selector must
+// stay under. The bounding pass over the whole pool is outside
+// FILTER_BUDGET_MS (see filter.h), hence the allowance on top of it.
+#define STRESS_ENTRIES 20000
+#define STRESS_LIMIT 24
+#define STRESS_P99_MS (FILTER_BUDGET_MS + 16)
+#define STRESS_ROUNDS 5
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dull;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return (uint32_t)(rng_state >> 32);
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+typedef void (*NameGen)(char *out, size_t max, size_t i);
+
+// Every letter of every query, spread out: all entries match everything,
+// so nothing is rejected cheaply and every bound is close to the others
+static void gen_all_match(char *out, size_t max, size_t i) {
+  size_t n = (size_t)snprintf(out, max, "2025-01-%02zu-", 1 + i % 28);
+  while (n < 80 && n + 1 < max) {
+    out[n++] = (char)('a' + rng() % 26);
+    if (rng() % 5 == 0 && n + 1 < max)
+      out[n++] = '-';
+  }
+  out[n] = '\0';
+}
+
+// Identical but for a numeric tail: equal scores everywhere, so the
+// refinement can't stop early
+static void gen_shared_prefix(char *out, size_t max, size_t i) {
+  snprintf(out, max, "2025-01-01-project-experiment-redis-pool-%06zu", i);
+}
+
+// Longer than the scoring tables, with the query's letters far apart
+static void gen_long(char *out, size_t max, size_t i) {
+  (void)i;
+  size_t len = 260 + rng() % 200;
+  if (len + 1 > max)
+    len = max - 1;
+  for (size_t n = 0; n < len; n++)
+    out[n] = rng() % 40 == 0 ? (char)('a' + rng() % 26) : 'x';
+  out[len] = '\0';
+}
+
+static void build(vec_TryEntry *entries, NameArena *names, NameGen gen) {
+  char buf[512];
+  time_t now = time(NULL);
+  for (size_t i = 0; i < STRESS_ENTRIES; i++) {
+    gen(buf, sizeof(buf), i);
+    TryEntry e = {0};
+    e.name = names_add(names, buf, strlen(buf));
+    e.rendered = zstr_init();
+    e.mtime = now - (time_t)(rng() % (86400 * 365));
+    vec_push_TryEntry(entries, e);
+  }
+}
+
+// Type each query and time every keystroke; returns the number of samples
+static size_t type_queries(vec_TryEntry *entries, double *samples, size_t max) {
+  static const char *const queries[] = {"redis", "pool", "abcdef", "exp", "zq", "2025", "aeiou"};
+  vec_TryEntryPtr shown = {0};
+  size_t count = 0;
+  for (int round = 0; round < STRESS_ROUNDS; round++) {
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+      char typed[16] = {0};
+      for (size_t k = 0; queries[q][k] && count < max; k++) {
+        typed[k] = queries[q][k];
+        double t0 = now_ms();
+        if (k == 0)
+          filter_rank(entries, typed, STRESS_LIMIT, FILTER_BUDGET_MS, &shown);
+        else
+          filter_narrow(entries, &shown, typed, STRESS_LIMIT, FILTER_BUDGET_MS, &shown);
+        samples[count++] = now_ms() - t0;
+      }
+    }
+  }
+  vec_free_TryEntryPtr(&shown);
+  return count;
+}
+
+static void check_corpus(const char *label, NameGen gen) {
+  vec_TryEntry entries = {0};
+  NameArena names = {0};
+  build(&entries, &names, gen);
+
+  double samples[512];
+  size_t n = type_queries(&entries, samples, sizeof(samples) / sizeof(samples[0]));
+  qsort(samples, n, sizeof(double), cmp_double);
+  double p99 = samples[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1];
+  double p50 = samples[n / 2];
+
+  TEST_CHECK_(p99 < STRESS_P99_MS, "%s: p99 keystroke %.2f ms (target %d ms)", label, p99,
+              STRESS_P99_MS);
+  TEST_MSG("%s: %zu keystrokes, p50 %.2f ms, p99 %.2f ms, worst %.2f ms", label, n, p50, p99,
+           samples[n - 1]);
+  free_try_entries(&entries, &names);
+}
+
+static void test_all_match(void) { check_corpus("all match", gen_all_match); }
+static void test_shared_prefix(void) { check_corpus("shared prefix", gen_shared_prefix); }
+static void test_long_names(void) { check_corpus("long names", gen_long); }
+
+TEST_LIST = {
+    {"all_match", test_all_match},
+    {"shared_prefix", test_shared_prefix},
+    {"long_names", test_long_names},
+    {NULL, NULL},
+};
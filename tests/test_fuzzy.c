@@ -0,0 +1,216 @@
+// Scoring tables and per-length kernels against the formula they replaced.
+// Scores must match bit for bit: equal scores keep scan order, so any drift
+// would reorder results.
+
+#define _GNU_SOURCE
+
+#include "acutest.h"
+#include "fuzzy.h"
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+// Defined by main.c in the real binary
+bool tui_no_colors = false;
+
+// ============================================================================
+// Reference: fuzzy_score() as it was before the tables, term by term
+// ============================================================================
+
+static bool ref_has_date_prefix(const char *text) {
+  return (strlen(text) >= 11 && isdigit(text[0]) && isdigit(text[1]) &&
+          isdigit(text[2]) && isdigit(text[3]) && text[4] == '-' &&
+          isdigit(text[5]) && isdigit(text[6]) && text[7] == '-' &&
+          isdigit(text[8]) && isdigit(text[9]) && text[10] == '-');
+}
+
+static double ref_recency_bonus(time_t mtime, time_t now) {
+  double hours_since_access = difftime(now, mtime) / 3600.0;
+  return 3.0 / sqrt(hours_since_access + 1);
+}
+
+static inline char ref_lower(char c) { return (char)tolower((unsigned char)c); }
+
+static float ref_score(const char *text, const char *query, time_t mtime, time_t now) {
+  float score = 0.0;
+  if (!query || !*query) {
+    score += ref_recency_bonus(mtime, now);
+    return score;
+  }
+
+  int query_len = (int)strlen(query);
+  int query_idx = 0;
+  int last_pos = -1;
+  float fuzzy_score = 0.0;
+
+  for (int pos = 0; text[pos]; pos++) {
+    if (query_idx < query_len && ref_lower(text[pos]) == ref_lower(query[query_idx])) {
+      fuzzy_score += 1.0;
+      if (pos == 0 || !isalnum((unsigned char)ref_lower(text[pos - 1])))
+        fuzzy_score += 1.0;
+      if (last_pos >= 0) {
+        int gap = pos - last_pos - 1;
+        fuzzy_score += 2.0 / sqrt(gap + 1);
+      }
+      last_pos = pos;
+      query_idx++;
+    }
+  }
+  if (query_idx < query_len)
+    return 0.0;
+
+  if (last_pos >= 0)
+    fuzzy_score *= ((float)query_len / (last_pos + 1));
+  int text_len = (int)strlen(text);
+  fuzzy_score *= (10.0 / (text_len + 10.0));
+
+  float date_bonus = ref_has_date_prefix(text) ? 2.0 : 0.0;
+  score = fuzzy_score + date_bonus;
+  score += ref_recency_bonus(mtime, now);
+  return score;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return (uint32_t)(rng_state >> 32);
+}
+
+static bool same_bits(float a, float b) { return memcmp(&a, &b, sizeof(float)) == 0; }
+
+// Compare one name/query pair; reports the pair on failure
+static bool check_pair(const char *name, const char *query, time_t mtime, time_t now) {
+  TryEntry entry = {.name = zstr_view_from(name), .mtime = mtime};
+  float want = ref_score(name, query, mtime, now);
+  float got = fuzzy_score(&entry, query, now);
+  if (!TEST_CHECK_(same_bits(got, want), "score of '%s' for '%s'", query, name)) {
+    TEST_MSG("tables %.9g, formula %.9g", got, want);
+    return false;
+  }
+
+  // The bound must never undercut the exact score, and must agree on
+  // whether the query matches at all
+  float bound;
+  bool matches = fuzzy_bound(&entry, query, now, &bound);
+  if (!TEST_CHECK_(matches == (!*query || want > 0), "match of '%s' for '%s'", query, name))
+    return false;
+  if (matches && !TEST_CHECK_(bound >= got, "bound of '%s' for '%s'", query, name)) {
+    TEST_MSG("bound %.9g, score %.9g", bound, got);
+    return false;
+  }
+  return true;
+}
+
+// Names mixing the characters that matter: case, word boundaries, digits
+// (date prefixes) and bytes above 0x7f
+static size_t random_name(char *out, size_t max) {
+  static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_. ";
+  size_t len = 1 + rng() % (max - 1);
+  size_t i = 0;
+  if (rng() % 2 && len > 11) {
+    i = (size_t)snprintf(out, 12, "20%02u-%02u-%02u-", rng() % 100, 1 + rng() % 12, 1 + rng() % 28);
+  }
+  for (; i < len; i++) {
+    uint32_t r = rng() % 16;
+    out[i] = r == 0 ? (char)(0x80 + rng() % 0x80) : alphabet[rng() % (sizeof(alphabet) - 1)];
+  }
+  out[len] = '\0';
+  return len;
+}
+
+// Mostly subsequences of name (so they match), case-flipped at random;
+// sometimes random bytes (so they mostly don't)
+static void random_query(const char *name, size_t name_len, char *out, size_t max) {
+  size_t n = 1 + rng() % (max - 1);
+  if (rng() % 4 == 0) {
+    for (size_t i = 0; i < n; i++)
+      out[i] = (char)(1 + rng() % 255);
+    out[n] = '\0';
+    return;
+  }
+  size_t k = 0;
+  for (size_t pos = rng() % name_len; pos < name_len && k < n; pos += 1 + rng() % 4) {
+    char c = name[pos];
+    out[k++] = rng() % 3 == 0 ? (char)toupper((unsigned char)c) : c;
+  }
+  out[k] = '\0';
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static void test_fixture(void) {
+  static const char *const names[] = {
+      "2025-01-02-redis-connection-pool", "redis", "rp", "r", "2025-13-99-not-a-date",
+      "2024-06-30-", "Rust_Playground", "a.b.c", "x", "über-project", "2025-01-01"};
+  static const char *const queries[] = {"", "r", "rp", "rcp", "redis", "RP", "pool",
+                                        "2025", "-", "zz", "rust", "abc", "ü"};
+  time_t now = 1700000000;
+  time_t mtimes[] = {now, now - 3600, now - 86400 * 30, now + 60};
+
+  for (size_t n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+      for (size_t m = 0; m < sizeof(mtimes) / sizeof(mtimes[0]); m++)
+        check_pair(names[n], queries[q], mtimes[m], now);
+    }
+  }
+}
+
+// calculate_score() reads the clock itself: retry if it ticked in between
+static void test_calculate_score(void) {
+  static const char *const pairs[][2] = {
+      {"2025-01-02-redis-connection-pool", "rp"}, {"redis", "REDIS"}, {"a-b-c", "abc"}};
+  for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+    time_t mtime = time(NULL) - 7200;
+    float got, want;
+    time_t before, after;
+    do {
+      before = time(NULL);
+      got = calculate_score(pairs[i][0], pairs[i][1], mtime);
+      after = time(NULL);
+      want = ref_score(pairs[i][0], pairs[i][1], mtime, after);
+    } while (before != after);
+    TEST_CHECK_(same_bits(got, want), "calculate_score('%s', '%s')", pairs[i][0], pairs[i][1]);
+  }
+}
+
+static void test_random(void) {
+  char name[64], query[16];
+  time_t now = 1700000000;
+  for (int i = 0; i < 200000; i++) {
+    size_t len = random_name(name, sizeof(name));
+    random_query(name, len, query, sizeof(query));
+    if (!check_pair(name, query, now - (time_t)(rng() % (86400 * 400)), now))
+      return;
+  }
+}
+
+// Past FUZZY_TABLE_LEN (256) the terms are computed rather than looked up;
+// gaps and match positions beyond it must agree too
+static void test_long_names(void) {
+  char name[700], query[24];
+  time_t now = 1700000000;
+  for (int i = 0; i < 20000; i++) {
+    size_t len = random_name(name, 200 + rng() % (sizeof(name) - 200));
+    random_query(name, len, query, sizeof(query));
+    if (!check_pair(name, query, now - (time_t)(rng() % 86400), now))
+      return;
+  }
+}
+
+TEST_LIST = {
+    {"fixture", test_fixture},
+    {"calculate_score", test_calculate_score},
+    {"random", test_random},
+    {"long_names", test_long_names},
+    {NULL, NULL},
+};